@@ -1,50 +1,164 @@
 #include "FrameStream.h"
 #include "RenderStream.h"
+#include "RenderStreamStats.h"
 
 #include "RSUCHelpers.inl"
 
+namespace
+{
+    // d3 reads Vulkan stream textures on its own queue and nothing signals when it is done, so a buffer can't be known to
+    // be free again and every send uses the one texture, as before output rings.
+    int32 NumOutputBuffers()
+    {
+        static const bool bVulkan = FHardwareInfo::GetHardwareInfo(NAME_RHI) == "Vulkan";
+        return bVulkan ? 1 : FMath::Clamp(GetDefault<URenderStreamSettings>()->StreamOutputBuffers, 1, 4);
+    }
+}
+
 FFrameStream::FFrameStream()
-    : m_streamName(""), m_bufTexture(nullptr), m_handle(0) {}
+    : m_streamName(""), m_stateOwner(MakeShared<FFrameStreamState, ESPMode::ThreadSafe>()), m_state(m_stateOwner.Get()), m_output(0), m_numOutputs(0), m_viewportHandle(INDEX_NONE), m_mappingId(0), m_viewpoint(-1) {}
 
 FFrameStream::~FFrameStream()
 {
 }
 
-void FFrameStream::SendFrame_RenderingThread(FRHICommandListImmediate& RHICmdList, RenderStreamLink::CameraResponseData& FrameData, FRHITexture* SourceTexture, const FIntRect& ViewportRect)
+void FFrameStream::SendFrame_RenderingThread(FRHICommandListImmediate& RHICmdList, RenderStreamLink::CameraResponseData& FrameData, FRHITexture* SourceTexture, const FIntRect& ViewportRect, const RenderStreamLink::ProjectionClipping& Crop)
 {
-    float ULeft = (float)ViewportRect.Min.X / (float)SourceTexture->GetSizeX();
-    float URight = (float)ViewportRect.Max.X / (float)SourceTexture->GetSizeX();
-    float VTop = (float)ViewportRect.Min.Y / (float)SourceTexture->GetSizeY();
-    float VBottom = (float)ViewportRect.Max.Y / (float)SourceTexture->GetSizeY();
-    RSUCHelpers::SendFrame(m_handle, m_bufTexture, RHICmdList, FrameData, SourceTexture, SourceTexture->GetSizeXY(), { ULeft, URight }, { VTop, VBottom });
+    const RenderStreamLink::StreamHandle Handle = State().Handle;
+    if (Handle == 0 || m_outputs.Num() == 0)
+        return; // retired
+
+    // Write the oldest buffer. Its fence is written after d3's read of it, so it is only still pending when the GPU is a
+    // whole ring of frames behind. Then this frame falls back to flushing before its send, as a single buffer does.
+    m_output = (m_output + 1) % m_outputs.Num();
+    FOutputBuffer& Output = m_outputs[m_output];
+    const bool bRing = m_outputs.Num() > 1;
+    const bool bStalled = bRing && Output.bInFlight && !Output.Fence->Poll();
+    if (bStalled)
+        INC_DWORD_STAT(STAT_StreamOutputStalls);
+
+    const float Width = (float)ViewportRect.Width();
+    const float Height = (float)ViewportRect.Height();
+    float ULeft = ((float)ViewportRect.Min.X + Crop.left * Width) / (float)SourceTexture->GetSizeX();
+    float URight = ((float)ViewportRect.Min.X + Crop.right * Width) / (float)SourceTexture->GetSizeX();
+    float VTop = ((float)ViewportRect.Min.Y + Crop.top * Height) / (float)SourceTexture->GetSizeY();
+    float VBottom = ((float)ViewportRect.Min.Y + Crop.bottom * Height) / (float)SourceTexture->GetSizeY();
+    RSUCHelpers::SendFrame(Handle, Output.Texture, Output.Format, RHICmdList, FrameData, SourceTexture, SourceTexture->GetSizeXY(), { ULeft, URight }, { VTop, VBottom }, Output.bInvertAlpha, m_blit, !bRing || bStalled, Output.Fence);
+    Output.bInFlight = bRing;
+}
+
+void FFrameStream::SendDuplicate_RenderingThread(FRHICommandListImmediate& RHICmdList, RenderStreamLink::CameraResponseData& FrameData, const FFrameStream& Source)
+{
+    const RenderStreamLink::StreamHandle Handle = State().Handle;
+    if (Handle == 0 || Source.m_outputs.Num() == 0)
+        return; // retired
+
+    SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Send Duplicate Frame"));
+    const FOutputBuffer& Output = Source.m_outputs[Source.m_output];
+    RSUCHelpers::QueueFrame(Handle, Output.Texture, Output.Format, RHICmdList, FrameData, Source.m_outputs.Num() == 1);
 }
 
 bool FFrameStream::Setup(const FString& name, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat fmt)
 {
-    if (m_handle != 0)
+    if (this->Handle() != 0)
         return false; // already have a stream handle call stop first
 
-    m_handle = Handle;
-    m_channel = Channel;
-    m_clipping = Clipping;
-    m_resolution = Resolution;
     m_streamName = name;
-
-    if (!RSUCHelpers::CreateStreamResources(m_bufTexture, m_resolution, fmt))
-        return false; // helper method logs on failure
-
-    if (m_handle == 0) {
+    if (Handle == 0) {
         UE_LOG(LogRenderStream, Error, TEXT("Unable to create stream"));
         return false;
     }
+
+    TSharedRef<FFrameStreamState, ESPMode::ThreadSafe> State = MakeShared<FFrameStreamState, ESPMode::ThreadSafe>();
+    State->Channel = Channel;
+    State->Clipping = Clipping;
+    State->Resolution = Resolution;
+    State->Format = fmt;
+    State->Handle = Handle;
+    if (!CreateOutputs(*State))
+        return false; // helper method logs on failure
+
+    SetState(State);
     UE_LOG(LogRenderStream, Log, TEXT("Created stream '%s'"), *m_streamName);
     
     return true;
 }
 
-void FFrameStream::Update(const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt)
+EStreamChange FFrameStream::Update(const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt)
 {
-    // Todo: Do we need to destroy the handle?
-    m_handle = 0;
-    Setup(m_streamName, Resolution, Channel, Clipping, Handle, Fmt);
-}
\ No newline at end of file
+    const FFrameStreamState& Current = State();
+    EStreamChange Changes = EStreamChange::None;
+    if (Handle != Current.Handle)
+        Changes |= EStreamChange::Handle;
+    if (FMemory::Memcmp(&Clipping, &Current.Clipping, sizeof(Clipping)) != 0)
+        Changes |= EStreamChange::Clipping;
+    if (Channel != Current.Channel)
+        Changes |= EStreamChange::Channel;
+    const int32 NumOutputs = NumOutputBuffers();
+    if (Resolution != Current.Resolution || Fmt != Current.Format || m_numOutputs != NumOutputs)
+        Changes |= EStreamChange::Resources;
+    if (Changes == EStreamChange::None)
+        return Changes;
+
+    TSharedRef<FFrameStreamState, ESPMode::ThreadSafe> State = MakeShared<FFrameStreamState, ESPMode::ThreadSafe>(Current);
+    State->Handle = Handle;
+    State->Channel = Channel;
+    State->Clipping = Clipping;
+
+    // The shared texture is only recreated when its description changes, that is the expensive part of a reconfiguration.
+    if (EnumHasAnyFlags(Changes, EStreamChange::Resources))
+    {
+        State->Resolution = Resolution;
+        State->Format = Fmt;
+        if (!CreateOutputs(*State))
+        {
+            UE_LOG(LogRenderStream, Error, TEXT("Unable to recreate resources for stream '%s' at %dx%d"), *m_streamName, Resolution.X, Resolution.Y);
+            return EStreamChange::Failed;
+        }
+        UE_LOG(LogRenderStream, Log, TEXT("Recreated resources for stream '%s'"), *m_streamName);
+    }
+
+    SetState(State);
+    return Changes;
+}
+
+void FFrameStream::Retire()
+{
+    TSharedRef<FFrameStreamState, ESPMode::ThreadSafe> State = MakeShared<FFrameStreamState, ESPMode::ThreadSafe>(this->State());
+    State->Handle = 0;
+    SetState(State);
+}
+
+void FFrameStream::SetState(FFrameStreamStatePtr State)
+{
+    // The replaced state stays referenced by the current pool snapshot, the pool publishes a new one after every change
+    m_state.store(State.Get(), std::memory_order_release);
+    m_stateOwner = MoveTemp(State);
+}
+
+bool FFrameStream::CreateOutputs(const FFrameStreamState& State)
+{
+    const int32 NumOutputs = NumOutputBuffers();
+    RenderStreamLink::RSPixelFormat SentFormat;
+    const EPixelFormat Format = RSUCHelpers::NegotiateStreamFormat(State.Format, SentFormat);
+    TArray<FOutputBuffer> Outputs;
+    Outputs.SetNum(NumOutputs);
+    for (FOutputBuffer& Output : Outputs)
+    {
+        Output.Format = SentFormat;
+        Output.bInvertAlpha = RSUCHelpers::GetStreamFormat(State.Format).bHasAlpha;
+        if (!RSUCHelpers::CreateStreamResources(Output.Texture, State.Resolution, Format))
+            return false;
+        if (NumOutputs > 1)
+            Output.Fence = RHICreateGPUFence(TEXT("RenderStream:StreamOutput"));
+    }
+
+    // The rendering thread may be sending from the current buffers
+    m_numOutputs = NumOutputs;
+    ENQUEUE_RENDER_COMMAND(RenderStreamOutputs)([Self = AsShared(), Outputs = MoveTemp(Outputs)](FRHICommandListImmediate&) mutable {
+        Self->m_outputs = MoveTemp(Outputs);
+        Self->m_output = 0;
+        Self->m_blit = {};
+    });
+    return true;
+}
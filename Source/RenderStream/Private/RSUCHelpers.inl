@@ -1,6 +1,7 @@
 #pragma once
 
 #include "RenderStreamLink.h"
+#include "RenderStreamFrameSubmission.h"
 
 #include "HardwareInfo.h"
 
@@ -33,6 +34,9 @@ namespace {
     {
         DECLARE_EXPORTED_SHADER_TYPE(RSResizeCopy, Global, /* RenderStream */);
     public:
+        // UE's alpha is inverted, streams without an alpha channel don't need to pay for putting it back
+        class FInvertAlpha : SHADER_PERMUTATION_BOOL("INVERT_ALPHA");
+        using FPermutationDomain = TShaderPermutationDomain<FInvertAlpha>;
 
         static bool ShouldCache(EShaderPlatform Platform)
         {
@@ -50,8 +54,9 @@ namespace {
             : FGlobalShader(Initializer)
         { }
 
-
-        void SetParameters(FRHICommandList& RHICmdList, TRefCountPtr<FRHITexture> RGBTexture, const FIntPoint& OutputDimensions);
+        // Kept by the stream for as long as it samples the same texture.
+        static FUniformBufferRHIRef CreateParameters(FRHITexture* RGBTexture, const FIntPoint& OutputDimensions);
+        void SetParameters(FRHICommandList& RHICmdList, FRHIUniformBuffer* Parameters);
     };
 
 
@@ -67,7 +72,7 @@ namespace {
     IMPLEMENT_GLOBAL_SHADER_PARAMETER_STRUCT(RSResizeCopyUB, "RSResizeCopyUB");
     IMPLEMENT_SHADER_TYPE(, RSResizeCopy, TEXT("/" RS_PLUGIN_NAME "/Private/copy.usf"), TEXT("RSCopyPS"), SF_Pixel);
 
-    void RSResizeCopy::SetParameters(FRHICommandList& CommandList, TRefCountPtr<FRHITexture> RGBTexture, const FIntPoint& OutputDimensions)
+    FUniformBufferRHIRef RSResizeCopy::CreateParameters(FRHITexture* RGBTexture, const FIntPoint& OutputDimensions)
     {
         RSResizeCopyUB UB;
         {
@@ -76,28 +81,88 @@ namespace {
             UB.UVScale = FVector2f((float)OutputDimensions.X / (float)RGBTexture->GetSizeX(), (float)OutputDimensions.Y / (float)RGBTexture->GetSizeY());
         }
 
-        TUniformBufferRef<RSResizeCopyUB> Data = TUniformBufferRef<RSResizeCopyUB>::CreateUniformBufferImmediate(UB, UniformBuffer_SingleFrame);
+        return TUniformBufferRef<RSResizeCopyUB>::CreateUniformBufferImmediate(UB, UniformBuffer_MultiFrame);
+    }
+
+    void RSResizeCopy::SetParameters(FRHICommandList& CommandList, FRHIUniformBuffer* Parameters)
+    {
         FRHIBatchedShaderParameters Params;
-        SetUniformBufferParameter(Params, GetUniformBufferParameter<RSResizeCopyUB>(), Data);
+        SetUniformBufferParameter(Params, GetUniformBufferParameter<RSResizeCopyUB>(), Parameters);
         CommandList.SetBatchedShaderParameters(CommandList.GetBoundPixelShader(), Params);
     }
 
+    // Like CreateTempMediaVertexBuffer, but kept by the stream while its crop doesn't change.
+    FBufferRHIRef CreateBlitVertexBuffer(FRHICommandListImmediate& RHICmdList, float ULeft, float URight, float VTop, float VBottom)
+    {
+        FRHIResourceCreateInfo CreateInfo(TEXT("RenderStream:BlitVertices"));
+        FBufferRHIRef VertexBuffer = RHICmdList.CreateVertexBuffer(sizeof(FMediaElementVertex) * 4, BUF_Static, CreateInfo);
+        FMediaElementVertex* Vertices = static_cast<FMediaElementVertex*>(RHICmdList.LockBuffer(VertexBuffer, 0, sizeof(FMediaElementVertex) * 4, RLM_WriteOnly));
+        Vertices[0].Position.Set(-1.0f, 1.0f, 1.0f, 1.0f); // Top Left
+        Vertices[1].Position.Set(1.0f, 1.0f, 1.0f, 1.0f); // Top Right
+        Vertices[2].Position.Set(-1.0f, -1.0f, 1.0f, 1.0f); // Bottom Left
+        Vertices[3].Position.Set(1.0f, -1.0f, 1.0f, 1.0f); // Bottom Right
+        Vertices[0].TextureCoordinate.Set(ULeft, VTop);
+        Vertices[1].TextureCoordinate.Set(URight, VTop);
+        Vertices[2].TextureCoordinate.Set(ULeft, VBottom);
+        Vertices[3].TextureCoordinate.Set(URight, VBottom);
+        RHICmdList.UnlockBuffer(VertexBuffer);
+        return VertexBuffer;
+    }
+
 }
 
 namespace RSUCHelpers
 {
-    static void SendFrame(const RenderStreamLink::StreamHandle Handle,
-        FTextureRHIRef& BufTexture,
+    // Copies the cropped part of the source into the stream's texture when it is already the right size and format and the
+    // alpha needn't be inverted. False when a draw is needed.
+    static bool CopyFrame(FTextureRHIRef& BufTexture,
         FRHICommandListImmediate& RHICmdList,
-        RenderStreamLink::CameraResponseData FrameData,
         FRHITexture* InSourceTexture,
         FIntPoint Point,
         FVector2f CropU,
-        FVector2f CropV)
+        FVector2f CropV,
+        bool bInvertAlpha)
     {
-        SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Send Frame"));
+        if (bInvertAlpha || InSourceTexture->GetFormat() != BufTexture->GetFormat())
+            return false;
+
+        const FIntPoint Size = BufTexture->GetSizeXY();
+        const FVector2f Min(CropU.X * Point.X, CropV.X * Point.Y);
+        const FVector2f Max(CropU.Y * Point.X, CropV.Y * Point.Y);
+        const FIntPoint SourceMin(FMath::RoundToInt(Min.X), FMath::RoundToInt(Min.Y));
+        constexpr float Tolerance = 0.01f; // of a pixel
+        if (!FMath::IsNearlyEqual(Min.X, float(SourceMin.X), Tolerance) || !FMath::IsNearlyEqual(Min.Y, float(SourceMin.Y), Tolerance)
+            || !FMath::IsNearlyEqual(Max.X - Min.X, float(Size.X), Tolerance) || !FMath::IsNearlyEqual(Max.Y - Min.Y, float(Size.Y), Tolerance))
+            return false;
+
+        SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Copy"));
+        FRHICopyTextureInfo CopyInfo;
+        CopyInfo.Size = FIntVector(Size.X, Size.Y, 1);
+        CopyInfo.SourcePosition = FIntVector(SourceMin.X, SourceMin.Y, 0);
+        RHICmdList.Transition({
+            FRHITransitionInfo(InSourceTexture, ERHIAccess::SRVMask, ERHIAccess::CopySrc),
+            FRHITransitionInfo(BufTexture, ERHIAccess::CopySrc | ERHIAccess::ResolveSrc, ERHIAccess::CopyDest) });
+        RHICmdList.CopyTexture(InSourceTexture, BufTexture, CopyInfo);
+        RHICmdList.Transition({
+            FRHITransitionInfo(InSourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask),
+            FRHITransitionInfo(BufTexture, ERHIAccess::CopyDest, ERHIAccess::CopySrc | ERHIAccess::ResolveSrc) });
+        return true;
+    }
+
+    // Resizes the cropped part of the source into the stream's texture, reusing the stream's blit state where it still applies.
+    static void BlitFrame(FTextureRHIRef& BufTexture,
+        FRHICommandListImmediate& RHICmdList,
+        FRHITexture* InSourceTexture,
+        FIntPoint Point,
+        FVector2f CropU,
+        FVector2f CropV,
+        bool bInvertAlpha,
+        FStreamBlitState& State)
+    {
+        if (CopyFrame(BufTexture, RHICmdList, InSourceTexture, Point, CropU, CropV, bInvertAlpha))
+            return;
+
         // convert the source with a draw call
-        FGraphicsPipelineStateInitializer GraphicsPSOInit;
         FRHITexture* RenderTarget = BufTexture.GetReference();
         FRHIRenderPassInfo RPInfo(RenderTarget, ERenderTargetActions::DontLoad_Store);
 
@@ -107,171 +172,209 @@ namespace RSUCHelpers
 
             RHICmdList.Transition(FRHITransitionInfo(BufTexture, ERHIAccess::CopySrc | ERHIAccess::ResolveSrc, ERHIAccess::RTV));
 
-            RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
-
-            GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-            GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
-            GraphicsPSOInit.BlendState = TStaticBlendStateWriteMask<CW_RGBA, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE>::GetRHI();
-            GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
-
             // configure media shaders
             auto ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
-            TShaderMapRef<FMediaShadersVS> VertexShader(ShaderMap);
+            RSResizeCopy::FPermutationDomain Permutation;
+            Permutation.Set<RSResizeCopy::FInvertAlpha>(bInvertAlpha);
+            TShaderMapRef<RSResizeCopy> ConvertShader(ShaderMap, Permutation);
 
-            GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GMediaVertexDeclaration.VertexDeclarationRHI;
-            GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+            // The render target's format and the shaders don't change for the lifetime of the stream's outputs
+            if (!State.bPipelineStateValid)
+            {
+                FGraphicsPipelineStateInitializer& GraphicsPSOInit = State.PipelineState;
+                RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+
+                GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+                GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
+                GraphicsPSOInit.BlendState = TStaticBlendStateWriteMask<CW_RGBA, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE, CW_NONE>::GetRHI();
+                GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
+
+                TShaderMapRef<FMediaShadersVS> VertexShader(ShaderMap);
+                GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GMediaVertexDeclaration.VertexDeclarationRHI;
+                GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+                GraphicsPSOInit.BoundShaderState.PixelShaderRHI = ConvertShader.GetPixelShader();
+                State.bPipelineStateValid = true;
+            }
+            SetGraphicsPipelineState(RHICmdList, State.PipelineState, 0);
 
-            TShaderMapRef<RSResizeCopy> ConvertShader(ShaderMap);
-            GraphicsPSOInit.BoundShaderState.PixelShaderRHI = ConvertShader.GetPixelShader();
-            SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
-            auto streamTexSize = BufTexture->GetTexture2D()->GetSizeXY();
-            ConvertShader->SetParameters(RHICmdList, InSourceTexture, Point);
+            if (!State.Parameters || State.ParametersSource != InSourceTexture)
+            {
+                State.Parameters = RSResizeCopy::CreateParameters(InSourceTexture, Point);
+                State.ParametersSource = InSourceTexture;
+            }
+            ConvertShader->SetParameters(RHICmdList, State.Parameters);
 
             // draw full size quad into render target
-            float ULeft = CropU.X;
-            float URight = CropU.Y;
-            float VTop = CropV.X;
-            float VBottom = CropV.Y;
-            FBufferRHIRef VertexBuffer = CreateTempMediaVertexBuffer(ULeft, URight, VTop, VBottom);
-            RHICmdList.SetStreamSource(0, VertexBuffer, 0);
+            const FVector4f UVs(CropU.X, CropU.Y, CropV.X, CropV.Y);
+            if (!State.VertexBuffer || State.VertexUVs != UVs)
+            {
+                State.VertexBuffer = CreateBlitVertexBuffer(RHICmdList, UVs.X, UVs.Y, UVs.Z, UVs.W);
+                State.VertexUVs = UVs;
+            }
+            RHICmdList.SetStreamSource(0, State.VertexBuffer, 0);
 
             // set viewport to RT size
+            auto streamTexSize = BufTexture->GetTexture2D()->GetSizeXY();
             RHICmdList.SetViewport(0, 0, 0.0f, streamTexSize.X, streamTexSize.Y, 1.0f);
             RHICmdList.DrawPrimitive(0, 2, 1);
             RHICmdList.Transition(FRHITransitionInfo(BufTexture, ERHIAccess::RTV, ERHIAccess::CopySrc | ERHIAccess::ResolveSrc));
 
             RHICmdList.EndRenderPass();
         }
+    }
 
+    // Queues the stream's texture to be handed to d3 as the frame for Handle when the frame is submitted, see
+    // FRenderStreamFrameSubmission.
+    static void QueueFrame(const RenderStreamLink::StreamHandle Handle,
+        const FTextureRHIRef& BufTexture,
+        RenderStreamLink::RSPixelFormat Format, // what BufTexture was allocated as, see NegotiateStreamFormat
+        FRHICommandListImmediate& RHICmdList,
+        RenderStreamLink::CameraResponseData FrameData,
+        bool bFlush,
+        FRHIGPUFence* SentFence = nullptr)
+    {
         SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS API Block"));
         void* resource = BufTexture->GetTexture2D()->GetNativeResource();
 
+        RenderStreamLink::SenderFrame data = {};
         auto toggle = FHardwareInfo::GetHardwareInfo(NAME_RHI);
         if (toggle == "D3D11")
         {
-            {
-                SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Flush"));
-                RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThreadFlushResources);
-            }
-
-            RenderStreamLink::SenderFrame data = {};
             data.type = RenderStreamLink::SenderFrameType::RS_FRAMETYPE_DX11_TEXTURE;
             data.dx11.resource = static_cast<ID3D11Resource*>(resource);
-            RenderStreamLink::FrameResponseData Response = {};
-            Response.cameraData = &FrameData;
-
-            auto output = RenderStreamLink::instance().rs_sendFrame2(Handle, &data, &Response);
-            if (output != RenderStreamLink::RS_ERROR_SUCCESS)
-            {
-                UE_LOG(LogRenderStream, Log, TEXT("Failed to send frame: %d"), output);
-            }
         }
         else if (toggle == "D3D12")
         {
-            {
-                SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Flush"));
-                RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThreadFlushResources);
-            }
-
-            RenderStreamLink::SenderFrame data = {};
             data.type = RenderStreamLink::SenderFrameType::RS_FRAMETYPE_DX12_TEXTURE;
             data.dx12.resource = static_cast<ID3D12Resource*>(resource);
-
-            RenderStreamLink::FrameResponseData Response = {};
-            Response.cameraData = &FrameData;
-            {
-                SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("rs_sendFrame2"));
-                auto output = RenderStreamLink::instance().rs_sendFrame2(Handle, &data, &Response);
-                if (output != RenderStreamLink::RS_ERROR_SUCCESS)
-                {
-                    UE_LOG(LogRenderStream, Log, TEXT("Failed to send frame: %d"), output);
-                }
-            }
         }
         else if (toggle == "Vulkan")
         {
+            if (Format == RenderStreamLink::RS_FMT_INVALID)
             {
-                SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Flush"));
-                RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThreadFlushResources);
+                UE_LOG(LogRenderStream, Error, TEXT("RenderStream tried to send frame with unsupported format."));
+                return;
             }
 
-            RenderStreamLink::RSPixelFormat fmt = RenderStreamLink::RS_FMT_INVALID;
-            switch (BufTexture->GetFormat())
-            {
-                case EPixelFormat::PF_B8G8R8A8:
-                    fmt = RenderStreamLink::RS_FMT_BGRA8;
-                    break;
-                case EPixelFormat::PF_FloatRGBA:
-                    fmt = RenderStreamLink::RS_FMT_RGBA32F;
-                    break;
-                case EPixelFormat::PF_A16B16G16R16:
-                    fmt = RenderStreamLink::RS_FMT_RGBA16;
-                    break;
-                case EPixelFormat::PF_R8G8B8A8:
-                    fmt = RenderStreamLink::RS_FMT_RGBA8;
-                    break;
-                default:
-                    UE_LOG(LogRenderStream, Error, TEXT("RenderStream tried to send frame with unsupported format."));
-                    return;
-            }
-
-            FVulkanTexture* VulkanTexture = ResourceCast(BufTexture);
+            FVulkanTexture* VulkanTexture = ResourceCast(BufTexture.GetReference());
             auto point2 = VulkanTexture->GetSizeXY();
 
-            RenderStreamLink::SenderFrame data = {};
             data.type = RenderStreamLink::SenderFrameType::RS_FRAMETYPE_VULKAN_TEXTURE;
             data.vk.memory = VulkanTexture->GetAllocationHandle();
             data.vk.size = VulkanTexture->GetAllocationOffset() + VulkanTexture->GetMemorySize();
-            data.vk.format = fmt;
+            data.vk.format = Format;
             data.vk.width = uint32_t(point2.X);
             data.vk.height = uint32_t(point2.Y);
             // TODO: semaphores
-            
-            RenderStreamLink::FrameResponseData Response = {};
-            Response.cameraData = &FrameData;
-            {
-                SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("rs_sendFrame2"));
-                auto output = RenderStreamLink::instance().rs_sendFrame2(Handle, &data, &Response);
-                if (output != RenderStreamLink::RS_ERROR_SUCCESS)
-                {
-                    UE_LOG(LogRenderStream, Log, TEXT("Failed to send frame: %d"), output);
-                }
-            }
         }
         else
         {
             UE_LOG(LogRenderStream, Error, TEXT("RenderStream tried to send frame with unsupported RHI backend."));
+            return;
         }
+
+        FRenderStreamFrameSubmission::Get().Add(Handle, data, FrameData, bFlush, SentFence);
+    }
+
+    static void SendFrame(const RenderStreamLink::StreamHandle Handle,
+        FTextureRHIRef& BufTexture,
+        RenderStreamLink::RSPixelFormat Format,
+        FRHICommandListImmediate& RHICmdList,
+        RenderStreamLink::CameraResponseData FrameData,
+        FRHITexture* InSourceTexture,
+        FIntPoint Point,
+        FVector2f CropU,
+        FVector2f CropV,
+        bool bInvertAlpha,
+        FStreamBlitState& State,
+        bool bFlush = true,
+        FRHIGPUFence* SentFence = nullptr)
+    {
+        SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Send Frame"));
+        BlitFrame(BufTexture, RHICmdList, InSourceTexture, Point, CropU, CropV, bInvertAlpha, State);
+        QueueFrame(Handle, BufTexture, Format, RHICmdList, FrameData, bFlush, SentFence);
+    }
+
+    // What each RenderStream format is allocated as. Formats are used natively when the RHI can render to them, otherwise
+    // the fallback is a format with at least the same precision and range that d3 can also describe.
+    struct FStreamFormat
+    {
+        EPixelFormat Native;
+        EPixelFormat Fallback;
+        RenderStreamLink::RSPixelFormat FallbackFormat;
+        bool bHasAlpha;
+        bool bNativeD3DOnly; // d3 only learns Native from the D3D texture itself, on Vulkan the RenderStream format doesn't describe it
+    };
+
+    static const FStreamFormat& GetStreamFormat(RenderStreamLink::RSPixelFormat rsFormat)
+    {
+        static const FStreamFormat formats[] = {
+            { PF_Unknown, PF_Unknown, RenderStreamLink::RS_FMT_INVALID, false, false },                  // RS_FMT_INVALID
+            { PF_B8G8R8A8, PF_R8G8B8A8, RenderStreamLink::RS_FMT_RGBA8, true, false },                   // RS_FMT_BGRA8
+            { PF_B8G8R8A8, PF_R8G8B8A8, RenderStreamLink::RS_FMT_RGBX8, false, false },                  // RS_FMT_BGRX8
+            { PF_A32B32G32R32F, PF_A32B32G32R32F, RenderStreamLink::RS_FMT_RGBA32F, true, false },       // RS_FMT_RGBA32F
+            { PF_FloatRGBA, PF_A32B32G32R32F, RenderStreamLink::RS_FMT_RGBA32F, true, true },            // RS_FMT_RGBA16, half float keeps values outside 0..1
+            { PF_R8G8B8A8, PF_B8G8R8A8, RenderStreamLink::RS_FMT_BGRA8, true, false },                   // RS_FMT_RGBA8
+            { PF_R8G8B8A8, PF_B8G8R8A8, RenderStreamLink::RS_FMT_BGRX8, false, false },                  // RS_FMT_RGBX8
+        };
+        return rsFormat < UE_ARRAY_COUNT(formats) ? formats[rsFormat] : formats[RenderStreamLink::RS_FMT_INVALID];
+    }
+
+    static bool CanRenderTo(EPixelFormat Format)
+    {
+        return Format != PF_Unknown && GPixelFormats[Format].Supported
+            && EnumHasAllFlags(GPixelFormats[Format].Capabilities, EPixelFormatCapabilities::RenderTarget);
+    }
+
+    // The UE format to allocate for a stream requested as rsFormat, and the RenderStream format that describes it.
+    static EPixelFormat NegotiateStreamFormat(RenderStreamLink::RSPixelFormat rsFormat, /*Out*/ RenderStreamLink::RSPixelFormat& SentFormat)
+    {
+        const FStreamFormat& format = GetStreamFormat(rsFormat);
+        SentFormat = rsFormat;
+        static const bool bVulkan = FHardwareInfo::GetHardwareInfo(NAME_RHI) == "Vulkan";
+        const bool bDescribed = !bVulkan || !format.bNativeD3DOnly;
+        if (bDescribed && (CanRenderTo(format.Native) || !CanRenderTo(format.Fallback)))
+            return format.Native;
+
+        // Logged once per format, every stream of the format falls back the same way
+        static bool logged[PF_MAX] = {};
+        if (!logged[format.Native])
+        {
+            logged[format.Native] = true;
+            UE_LOG(LogRenderStream, Warning, TEXT("Streams requested as RenderStream format %d can't be sent as %s, falling back to %s"),
+                int32(rsFormat), GPixelFormats[format.Native].Name, GPixelFormats[format.Fallback].Name);
+        }
+        SentFormat = format.FallbackFormat;
+        return format.Fallback;
     }
 
     static bool CreateStreamResources(/*InOut*/ FTextureRHIRef& BufTexture,
         const FIntPoint& Resolution,
-        RenderStreamLink::RSPixelFormat rsFormat)
+        EPixelFormat Format)
     {
-        struct
+        if (Format == PF_Unknown)
         {
-            DXGI_FORMAT dxgi;
-            EPixelFormat ue;
-        } formatMap[] = {
-            { DXGI_FORMAT_UNKNOWN, EPixelFormat::PF_Unknown },                 // RS_FMT_INVALID
-            { DXGI_FORMAT_B8G8R8A8_UNORM, EPixelFormat::PF_B8G8R8A8 },         // RS_FMT_BGRA8
-            { DXGI_FORMAT_B8G8R8X8_UNORM, EPixelFormat::PF_B8G8R8A8 },         // RS_FMT_BGRX8
-            { DXGI_FORMAT_R32G32B32A32_FLOAT, EPixelFormat::PF_A32B32G32R32F}, // RS_FMT_RGBA32F
-            { DXGI_FORMAT_R32G32B32A32_FLOAT, EPixelFormat::PF_A32B32G32R32F}, // RS_FMT_RGBA16 
-            { DXGI_FORMAT_R8G8B8A8_UNORM, EPixelFormat::PF_R8G8B8A8 },         // RS_FMT_RGBA8
-            { DXGI_FORMAT_R8G8B8A8_UNORM, EPixelFormat::PF_R8G8B8A8 },         // RS_FMT_RGBX8
-        };
-        const auto format = formatMap[rsFormat];
+            UE_LOG(LogRenderStream, Error, TEXT("Unable to create stream resources for an unknown format"));
+            return false;
+        }
 
+        // Only shared when d3 asks for a shared heap, only external where d3 imports the texture's memory
+        static const bool sharedHeap = [] {
+            RenderStreamLink::UseDX12SharedHeapFlag rs_flag = RenderStreamLink::RS_DX12_USE_SHARED_HEAP_FLAG;
+            RenderStreamLink::instance().rs_useDX12SharedHeapFlag(&rs_flag);
+            return rs_flag == RenderStreamLink::RS_DX12_USE_SHARED_HEAP_FLAG;
+        }();
         ETextureCreateFlags flags = ETextureCreateFlags::RenderTargetable;
-        RenderStreamLink::UseDX12SharedHeapFlag rs_flag = RenderStreamLink::RS_DX12_USE_SHARED_HEAP_FLAG;
-        RenderStreamLink::instance().rs_useDX12SharedHeapFlag(&rs_flag);
-        flags = static_cast<ETextureCreateFlags>(flags | ((rs_flag == RenderStreamLink::RS_DX12_USE_SHARED_HEAP_FLAG) ? ETextureCreateFlags::Shared : ETextureCreateFlags::None));
-        flags = flags | ETextureCreateFlags::External;
-        auto desc = FRHITextureCreateDesc::Create2D(TEXT("RenderStream:Stream"), Resolution.X, Resolution.Y, format.ue);
+        if (sharedHeap)
+            flags |= ETextureCreateFlags::Shared;
+        if (FHardwareInfo::GetHardwareInfo(NAME_RHI) == "Vulkan")
+            flags |= ETextureCreateFlags::External;
+
+        // Every send writes the whole texture, so it never needs clearing
+        auto desc = FRHITextureCreateDesc::Create2D(TEXT("RenderStream:Stream"), Resolution.X, Resolution.Y, Format);
         desc.AddFlags(flags);
-        desc.SetClearValue(FClearValueBinding::Green);
+        desc.SetClearValue(FClearValueBinding::None);
         BufTexture = RHICreateTexture(desc);
-        return true;
+        return BufTexture.IsValid();
     }
 }
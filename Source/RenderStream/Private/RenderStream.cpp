@@ -2,6 +2,12 @@
 
 #include "RenderStream.h"
 #include "RenderStreamLink.h"
+#include "RenderStreamLinkInstrumentation.h"
+#include "RenderStreamTrace.h"
+#include "RenderStreamAllocationCounter.h"
+#include "RenderStreamTelemetry.h"
+#include "RenderStreamCustomTimeStep.h"
+#include "RenderStreamFrameSubmission.h"
 
 #include "RenderStreamSettings.h"
 #include "RenderStreamSceneSelector.h"
@@ -20,6 +26,7 @@
 #include "Engine/LevelScriptActor.h"
 #include "Engine/World.h"
 #include "ShaderCore.h"
+#include "RenderingThread.h"
 
 #include "Interfaces/IPluginManager.h"
 #include "IDisplayCluster.h"
@@ -31,6 +38,7 @@
 #include "AssetRegistry/AssetRegistryModule.h"
 
 #include "Containers/Map.h"
+#include "Algo/AnyOf.h"
 
 #include "FrameStream.h"
 
@@ -198,15 +206,22 @@ void FRenderStreamModule::StartupModule()
             if (errCode == RenderStreamLink::RS_ERROR_INCOMPATIBLE_VERSION)
             {
                 UE_LOG(LogRenderStream, Error, TEXT("Unsupported RenderStream library, expected version %i.%i"), RENDER_STREAM_VERSION_MAJOR, RENDER_STREAM_VERSION_MINOR);
+                m_logDevice.Reset();
                 RenderStreamLink::instance().unloadExplicit();
                 return;
             }
 
             UE_LOG(LogRenderStream, Error, TEXT("Unable to initialise RenderStream library error code %d"), errCode);
+            m_logDevice.Reset();
             RenderStreamLink::instance().unloadExplicit();
             return;
         }
         
+        if (RenderStreamAllocationCounter::IsRequested())
+            RenderStreamAllocationCounter::Install();
+
+        RegisterMetrics();
+
         FCoreDelegates::OnHandleSystemError.AddRaw(this, &FRenderStreamModule::OnSystemError);
 
         FCoreUObjectDelegates::PostLoadMapWithWorld.AddRaw(this, &FRenderStreamModule::OnPostLoadMapWithWorld);
@@ -240,9 +255,15 @@ void FRenderStreamModule::ShutdownModule()
     UE_LOG(LogRenderStream, Log, TEXT("Shutting down RenderStream"));
 
     Monitor.Close();
+    m_syncFrame.StopAcquisition();
+    if (URenderStreamCustomTimeStep::IsActive())
+        GEngine->SetCustomTimeStep(nullptr);
+    RenderStreamTrace::StopCapture(RenderStreamLink::instance());
 
     FModuleManager::Get().OnModulesChanged().RemoveAll(this);
 
+    // Render commands the pool and its streams queued, like CaptureFrameGroups, reference them
+    FlushRenderingCommands();
     StreamPool.Reset();
 
     if (IDisplayCluster::IsAvailable())
@@ -278,6 +299,19 @@ void FRenderStreamModule::ShutdownModule()
     FWorldDelegates::OnStartGameInstance.RemoveAll(this);
     FCoreDelegates::GetApplicationWillTerminateDelegate().RemoveAll(this);
 
+    // Forwards any lines still queued, must happen before the link is unloaded
+    m_logDevice.Reset();
+
+    // On D3D11 frames are sent from the RHI thread, those sends must have run before the link is unloaded
+    if (GIsRHIInitialized)
+    {
+        ENQUEUE_RENDER_COMMAND(RenderStreamShutdown)([](FRHICommandListImmediate& RHICmdList) {
+            FRenderStreamFrameSubmission::Get().Discard_RenderingThread();
+            RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThread);
+        });
+        FlushRenderingCommands();
+    }
+
     // This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
     // we call this function before unloading the module.
     if (!RenderStreamLink::instance ().unloadExplicit ())
@@ -312,7 +346,7 @@ void FRenderStreamModule::ApplyScene(uint32_t sceneId)
     m_sceneSelector->ApplyScene(*GWorld, sceneId);
 }
 
-bool UpdateViewport(FFrameStreamPtr Stream)
+bool UpdateViewport(FFrameStreamPtr Stream, FIntPoint Resolution)
 {
     FString const& Name = Stream->Name();
     IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::Get().GetClusterMgr();
@@ -335,15 +369,16 @@ bool UpdateViewport(FFrameStreamPtr Stream)
     {
         if (Pair.Key == Name)
         {
-            auto Resolution = Stream->Resolution();
-
             // We don't care about the offset as we intercept before it is combined.
             //Viewport->Region.X = 0;
             //Viewport->Region.Y = 0;
-            Pair.Value->Region.W = Resolution.X;
-            Pair.Value->Region.H = Resolution.Y;
+            if (Pair.Value->Region.W != Resolution.X || Pair.Value->Region.H != Resolution.Y)
+            {
+                Pair.Value->Region.W = Resolution.X;
+                Pair.Value->Region.H = Resolution.Y;
+                UE_LOG(LogRenderStream, Log, TEXT("Viewport '%s' resized to (%d, %d)"), *Name, Resolution.X, Resolution.Y);
+            }
             Found = true;
-            UE_LOG(LogRenderStream, Log, TEXT("Viewport '%s' resized to (%d, %d)"), *Name, Resolution.X, Resolution.Y);
         }
 
         Width = FGenericPlatformMath::Max(Width, Pair.Value->Region.X + Pair.Value->Region.W);
@@ -366,12 +401,17 @@ void FRenderStreamModule::ConfigureStream(FFrameStreamPtr Stream)
         return;
     }
 
-    if (!UpdateViewport(Stream))
+    if (!UpdateViewport(Stream, StreamPool->GetRenderResolution(Stream)))
     {
         UE_LOG(LogRenderStream, Error, TEXT("Policy '%s' created without corresponding viewport"), *Name);
     }
 
-    FRenderStreamViewportInfo& Info = GetViewportInfo(Name);
+    const FRenderStreamViewportHandle Handle = InternViewport(Name);
+    Stream->SetViewportHandle(Handle);
+    if (Handle == INDEX_NONE)
+        return;
+
+    FRenderStreamViewportInfo& Info = GetViewportInfo(Handle);
     const FString Channel = Stream ? Stream->Channel() : "";
     const TWeakObjectPtr<ACameraActor> ChannelCamera = URenderStreamChannelDefinition::GetChannelCamera(Channel);
     if (ChannelCamera == nullptr)
@@ -461,7 +501,7 @@ bool FRenderStreamModule::PopulateStreamPool()
 
     if (RenderStreamLink::instance().isAvailable())
     {
-        std::vector<uint8_t> descMem;
+        std::vector<uint8_t>& descMem = m_streamDescMem;
         uint32_t nBytes = 0;
         RenderStreamLink::instance().rs_getStreams(nullptr, &nBytes);
 
@@ -504,6 +544,8 @@ bool FRenderStreamModule::PopulateStreamPool()
                 UE_LOG(LogRenderStream, Log, TEXT("Discovered new stream %s at %dx%d"), *Name, Resolution.X, Resolution.Y);
                 StreamPool->AddNewStreamToPool(Name, Resolution, Channel, description.clipping, description.handle, description.format);
                 Stream = StreamPool->GetStream(Name);
+                if (Stream)
+                    Stream->SetView(description.mappingId, description.iViewpoint);
 
                 // create a new viewport for this stream if needed
                 if (IDisplayCluster::IsAvailable())
@@ -532,9 +574,26 @@ bool FRenderStreamModule::PopulateStreamPool()
             }
             else
             {
+                Stream->SetView(description.mappingId, description.iViewpoint);
+
+                // Only redo the work that depends on what changed, most streams are untouched when d3 adds or removes one
+                const EStreamChange Changes = StreamPool->UpdateStream(Stream, Resolution, Channel, description.clipping, description.handle, description.format);
+                if (Changes == EStreamChange::None)
+                    continue;
+
+                if (Changes == EStreamChange::Failed)
+                {
+                    // It still holds textures of the old size or format, the next streams change sets it up again
+                    UE_LOG(LogRenderStream, Error, TEXT("Retiring stream %s, its resources couldn't be recreated"), *Name);
+                    StreamPool->RetireStream(Stream);
+                    continue;
+                }
+
                 UE_LOG(LogRenderStream, Log, TEXT("Updating stream %s at %dx%d"), *Name, Resolution.X, Resolution.Y);
-                Stream->Update(Resolution, Channel, description.clipping, description.handle, description.format);
-                if (IDisplayCluster::IsAvailable())
+                if (!EnumHasAnyFlags(Changes, EStreamChange::Resources | EStreamChange::Channel))
+                    continue; // handle and clipping are read from the stream every frame
+
+                if (EnumHasAnyFlags(Changes, EStreamChange::Resources) && IDisplayCluster::IsAvailable())
                 {
                     const FString LocalNodeId = IDisplayCluster::Get().GetConfigMgr()->GetLocalNodeId();
                     const ADisplayClusterRootActor* RootActor = IDisplayCluster::Get().GetGameMgr()->GetRootActor();
@@ -543,7 +602,8 @@ bool FRenderStreamModule::PopulateStreamPool()
 
                     if (UDisplayClusterConfigurationViewport* Viewport = ClusterNode->GetViewport(Name); Viewport)
                     {
-                        Viewport->Region = FDisplayClusterConfigurationRectangle(0, 0, Resolution.X, Resolution.Y);
+                        const FIntPoint RenderResolution = StreamPool->GetRenderResolution(Stream);
+                        Viewport->Region = FDisplayClusterConfigurationRectangle(0, 0, RenderResolution.X, RenderResolution.Y);
                     }
                 }
             }
@@ -551,6 +611,38 @@ bool FRenderStreamModule::PopulateStreamPool()
             ConfigureStream(Stream);
         }
         
+        // Streams d3 no longer provides stop sending now and are released once no frame in flight uses them
+        for (int32 i = StreamPool->GetAllStreams().Num() - 1; i >= 0; --i)
+        {
+            const FFrameStreamPtr Stream = StreamPool->GetAllStreams()[i];
+            const bool Provided = Algo::AnyOf(streamInfoArray, [&Stream](const FStreamInfo& Info) {
+                return Info.Name.Equals(Stream->Name(), ESearchCase::IgnoreCase);
+            });
+            if (!Provided)
+            {
+                UE_LOG(LogRenderStream, Log, TEXT("Retiring stream %s"), *Stream->Name());
+                StreamPool->RetireStream(Stream);
+            }
+        }
+
+        // Group leaders render the union of their fragments and duplicates, the others' viewports are cropped from it
+        const URenderStreamSettings* settings = GetDefault<URenderStreamSettings>();
+        StreamPool->SetGrouping(settings->RenderFragmentsOnce, settings->DeduplicateStreams);
+        for (const FFrameStreamPtr& Stream : StreamPool->GetAllStreams())
+        {
+            if (Stream->ViewportHandle() == INDEX_NONE)
+                continue;
+
+            const FStreamFragmentGroup* Group = StreamPool->GetFragmentGroup(Stream->Name());
+            FRenderStreamViewportInfo& Info = GetViewportInfo(Stream->ViewportHandle());
+            const FRenderStreamViewportHandle Leader = Group ? Group->Leader->ViewportHandle() : INDEX_NONE;
+            if (Leader != Info.FragmentLeader || (Group && Group->Leader == Stream))
+            {
+                Info.FragmentLeader = Leader;
+                UpdateViewport(Stream, StreamPool->GetRenderResolution(Stream));
+            }
+        }
+
         // Broadcast streams changed event
         for (TWeakObjectPtr<ARenderStreamEventHandler> eventHandler : m_eventHandlers)
         {
@@ -565,27 +657,58 @@ bool FRenderStreamModule::PopulateStreamPool()
 
 void FRenderStreamModule::ApplyCameras(const RenderStreamLink::FrameData& frameData)
 {
-    for (auto& pair  : ViewportInfos)
+    // The controller collects every stream's camera for the followers, followers use what they were sent.
+    FRenderStreamFrameBundle& bundle = m_syncFrame.m_bundle;
+    IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
+    if (ClusterMgr && ClusterMgr->IsPrimary() && ClusterMgr->GetNodesAmount() > 1 && FRenderStreamFrameBundle::IsEnabled())
+        bundle.CollectCameras(*StreamPool);
+
+    m_cameraPrediction = FRenderStreamCameraPredictor::ReadSettings(*GetDefault<URenderStreamSettings>());
+
+    const int32 NumInfos = NumViewports();
+    for (FRenderStreamViewportHandle Handle = 0; Handle < NumInfos; ++Handle)
     {
-        const FFrameStreamPtr stream = StreamPool->GetStream(pair.Key);
+        FRenderStreamViewportInfo& Info = m_viewports[Handle];
+        const FFrameStreamPtr stream = StreamPool->GetStream(Info.Id);
         if (!stream)
             continue;
 
+        if (const RenderStreamLink::CameraData* bundledCamera = bundle.FindCamera(stream->Handle()))
+        {
+            ApplyCameraData(Info, frameData, *bundledCamera);
+            continue;
+        }
+
         RenderStreamLink::CameraData cameraData;
         if (RenderStreamLink::instance().rs_getFrameCamera(stream->Handle(), &cameraData) == RenderStreamLink::RS_ERROR_SUCCESS)
-            ApplyCameraData(*pair.Value, frameData, cameraData);
+            ApplyCameraData(Info, frameData, cameraData);
     }
 }
 
-void FRenderStreamModule::ApplyCameraData(FRenderStreamViewportInfo& info, const RenderStreamLink::FrameData& frameData, const RenderStreamLink::CameraData& cameraData)
+void FRenderStreamModule::ApplyCameraData(FRenderStreamViewportInfo& info, const RenderStreamLink::FrameData& frameData, const RenderStreamLink::CameraData& trackedCamera)
 {
+    // Render from where the camera will be when the frame is shown. The response carries the pose actually rendered.
+    const RenderStreamLink::CameraData cameraData = info.m_predictor.Predict(trackedCamera, frameData.tTracked, m_cameraPrediction);
+
     // Each call must always have a frame response, because there will be a corresponding render call.
+    info.m_frameResponses.Write(GFrameCounter, { frameData.tTracked, cameraData });
+    info.RequestedFrame = GFrameCounter;
+    UpdateCamera(info, cameraData);
+
+    // The fragment group's leader renders for this viewport, with the same camera, even when its own stream isn't requested
+    if (info.FragmentLeader != INDEX_NONE)
     {
-        std::lock_guard<std::mutex> guard(info.m_frameResponsesLock);
-        uint64 frameCounter = GFrameCounter;
-        info.m_frameResponsesMap[frameCounter] = {frameData.tTracked, cameraData};
+        FRenderStreamViewportInfo& leader = GetViewportInfo(info.FragmentLeader);
+        if (&leader != &info && leader.RequestedFrame != GFrameCounter)
+        {
+            leader.RequestedFrame = GFrameCounter;
+            UpdateCamera(leader, cameraData);
+        }
     }
+}
 
+void FRenderStreamModule::UpdateCamera(FRenderStreamViewportInfo& info, const RenderStreamLink::CameraData& cameraData)
+{
     if (!info.Camera.IsValid())
         return;
 
@@ -719,6 +842,11 @@ void FRenderStreamModule::OnPostEngineInit()
         m_sceneSelector = std::make_unique<SceneSelector_None>();
     }
 
+    if (settings->DriveEngineTimeStep && GEngine && !GEngine->GetCustomTimeStep())
+    {
+        UE_LOG(LogRenderStream, Log, TEXT("Pacing the engine from RenderStream"));
+        GEngine->SetCustomTimeStep(NewObject<URenderStreamCustomTimeStep>(GEngine));
+    }
 }
 
 void FRenderStreamModule::GameInstanceStarted(UGameInstance* Instance)
@@ -763,10 +891,15 @@ void FRenderStreamModule::OnBeginFrame()
     if (!IsInCluster())
         return;
 
+    FRenderStreamAllocationScope AllocationScope;
+
+    if (StreamPool)
+        StreamPool->CollectRetired();
+
     // UpdateSyncObject
     IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
     const bool IsController = !ClusterMgr || ClusterMgr->IsPrimary();
-    if (IsController)
+    if (IsController && !URenderStreamCustomTimeStep::IsActive()) // otherwise it waits for the frame in UpdateTimeStep
         m_syncFrame.ControllerReceive();
 
     const URenderStreamSettings* settings = GetDefault<URenderStreamSettings>();
@@ -779,6 +912,19 @@ void FRenderStreamModule::OnBeginFrame()
     }
 }
 
+void FRenderStreamModule::SetIdle(bool bIdle)
+{
+    const ERenderStreamIdleState State = bIdle ? ERenderStreamIdleState::Idle : ERenderStreamIdleState::Active;
+    if (State == m_idleState)
+        return;
+
+    m_idleState = State;
+    if (State == ERenderStreamIdleState::Idle)
+        UE_LOG(LogRenderStream, Log, TEXT("No frames requested, rendering paused"));
+    else
+        UE_LOG(LogRenderStream, Log, TEXT("Frames requested, rendering resumed"));
+}
+
 void FRenderStreamModule::OnModulesChanged(FName ModuleName, EModuleChangeReason ReasonForChange)
 {
     if (ReasonForChange == EModuleChangeReason::ModuleLoaded && ModuleName == DisplayClusterModuleName)
@@ -914,63 +1060,92 @@ void EnableStatGroup(UObject* WorldContextObject, FName GroupName)
         TargetPC->ConsoleCommand(FString(TEXT("stat ")) + GroupName.ToString() + FString(TEXT(" -nodisplay")), /*bWriteToLog=*/false);
 }
 
-float GetStatValue(const FComplexStatMessage& Message)
+// Flat aggregates are reported exclusive of their children, counters are only ever inclusive.
+float GetStatValue(const FComplexStatMessage& Message, EComplexStatField::Type Field)
 {
     if (Message.NameAndInfo.GetFlag(EStatMetaFlags::IsCycle))
-        return FPlatformTime::ToMilliseconds(Message.GetValue_Duration(EComplexStatField::ExcAve));
+        return FPlatformTime::ToMilliseconds(Message.GetValue_Duration(Field));
 
     const EStatDataType::Type Type = Message.NameAndInfo.GetField<EStatDataType>();
     if (Type == EStatDataType::ST_double)
-        return (float)Message.GetValue_double(EComplexStatField::ExcAve);
+        return (float)Message.GetValue_double(Field);
     if (Type == EStatDataType::ST_int64)
-        return (float)Message.GetValue_int64(EComplexStatField::ExcAve);
+        return (float)Message.GetValue_int64(Field);
 
     // Unsupported
     return 0.f;
 }
 
-void ParseMessages(TArray<RenderStreamLink::ProfilingEntry>& Entries, TMap<FString, const char*>& MessageNames, const TArray<FComplexStatMessage>& Messages)
+void FetchStats(TArrayView<const FRenderStreamForwardedStat> Stats)
 {
-    if (MessageNames.Num() != 0)
+    FGameThreadStatsData* StatsData = FLatestGameThreadStatsData::Get().Latest;
+    if (!StatsData || Stats.Num() == 0)
+        return;
+
+    // Cycle stats are in each group's FlatAggregate, counters such as STAT_FrameLoopAllocations in its CountersAggregate.
+    // STAT_RHITriangles was tried but is giving weird values, requires more investigation.
+    const uint64 AllFound = Stats.Num() == 64 ? ~uint64(0) : (uint64(1) << Stats.Num()) - 1;
+    uint64 FoundMask = 0;
+    const auto Scan = [&](const TArray<FComplexStatMessage>& Messages, EComplexStatField::Type Field)
     {
         for (const FComplexStatMessage& Message : Messages)
         {
-            FString Name = Message.GetShortName().ToString();
-            const char** Entry = MessageNames.Find(Name);
-            if (Entry)
+            const FName Name = Message.GetShortName();
+            for (int32 i = 0; i < Stats.Num(); ++i)
             {
-                Entries.Push({ *Entry, GetStatValue(Message) });
-                MessageNames.Remove(Name);
+                if (!(FoundMask & (uint64(1) << i)) && Stats[i].Name == Name)
+                {
+                    FRenderStreamTelemetry::Get().Record(Stats[i].Metric, GetStatValue(Message, Field));
+                    FoundMask |= uint64(1) << i;
+                }
             }
 
-            if (MessageNames.Num() == 0)
-                break;
+            if (FoundMask == AllFound)
+                return;
         }
+    };
+
+    for (const FActiveStatGroupInfo& Group : StatsData->ActiveStatGroups)
+    {
+        Scan(Group.FlatAggregate, EComplexStatField::ExcAve);
+        Scan(Group.CountersAggregate, EComplexStatField::IncAve);
+        if (FoundMask == AllFound)
+            return;
     }
 }
+#endif
 
-void FetchStats(TArray<RenderStreamLink::ProfilingEntry>& Entries)
+void FRenderStreamModule::RegisterMetrics()
 {
-    FGameThreadStatsData* StatsData = FLatestGameThreadStatsData::Get().Latest;
-    if (StatsData)
+    const URenderStreamSettings* settings = GetDefault<URenderStreamSettings>();
+    FRenderStreamTelemetry& Telemetry = FRenderStreamTelemetry::Get();
+    Telemetry.Configure(*settings);
+
+    m_metrics.FrameTime = Telemetry.RegisterMetric(TEXT("Frame Time"));
+    m_metrics.GameTime = Telemetry.RegisterMetric(TEXT("Game Time"));
+    m_metrics.RenderTime = Telemetry.RegisterMetric(TEXT("Render Time"));
+    m_metrics.RHITime = Telemetry.RegisterMetric(TEXT("RHI Time"));
+    m_metrics.GPUTime = Telemetry.RegisterMetric(TEXT("GPU Time"));
+    m_metrics.IdleTime = Telemetry.RegisterMetric(TEXT("Unreal Idle Time"));
+    m_metrics.AwaitTime = Telemetry.RegisterMetric(TEXT("Await Time"));
+    m_metrics.ReceiveTime = Telemetry.RegisterMetric(TEXT("Receive Time"));
+    m_metrics.FrameLoopAllocations = Telemetry.RegisterMetric(TEXT("Frame Loop Allocations"));
+    m_metrics.CameraResponsesDropped = Telemetry.RegisterMetric(TEXT("Camera Responses Dropped"));
+    m_metrics.CameraResponseMismatches = Telemetry.RegisterMetric(TEXT("Camera Response Mismatches"));
+    m_syncFrame.m_scheduler.RegisterMetrics();
+
+    // FetchStats tracks the stats it has found in a 64 bit mask
+    m_forwardedStats.Reset();
+    for (const FName& StatName : settings->TelemetryStats)
     {
-        TMap<FString, const char*> FlatStats = {
-            {FStat_STAT_AwaitFrame::GetStatName(), FStat_STAT_AwaitFrame::GetStatName()},
-            {FStat_STAT_ReceiveFrame::GetStatName(), FStat_STAT_ReceiveFrame::GetStatName()}
-        };
-        TMap<FString, const char*> CounterStats = {
-            // This is giving weird values, requires more investigation.
-            //{FStat_STAT_RHITriangles::GetStatName(), FStat_STAT_RHITriangles::GetStatName()}
-        };
-
-        for (const FActiveStatGroupInfo& Group : StatsData->ActiveStatGroups)
+        if (m_forwardedStats.Num() == 64)
         {
-            ParseMessages(Entries, FlatStats, Group.FlatAggregate);
-            ParseMessages(Entries, CounterStats, Group.CountersAggregate);
+            UE_LOG(LogRenderStream, Warning, TEXT("Only the first 64 telemetry stats are forwarded"));
+            break;
         }
+        m_forwardedStats.Add({ StatName, Telemetry.RegisterMetric(StatName.ToString()) });
     }
 }
-#endif
 
 void FRenderStreamModule::EnableStats() const
 {
@@ -985,13 +1160,27 @@ void FRenderStreamModule::OnEndFrame()
     if (!IsInCluster())
         return;
 
-    TArray<RenderStreamLink::ProfilingEntry> Entries;
+    // Every viewport of the frame has been sent by the time this runs on the rendering thread
+    ENQUEUE_RENDER_COMMAND(RenderStreamSubmitFrames)([](FRHICommandListImmediate& RHICmdList) {
+        FRenderStreamFrameSubmission::Get().Submit_RenderingThread(RHICmdList);
+    });
+
+    const uint32 FrameLoopAllocations = RenderStreamAllocationCounter::ConsumeCount();
+    SET_DWORD_STAT(STAT_FrameLoopAllocations, FrameLoopAllocations);
+    FRenderStreamAllocationScope AllocationScope;
+
+    // Nothing was rendered, the frame times would only report how long the controller waited for d3
+    if (IsIdle())
+        return;
+
+    FRenderStreamTelemetry& Telemetry = FRenderStreamTelemetry::Get();
 #if STATS
-    FetchStats(Entries);
+    FetchStats(m_forwardedStats);
 #endif
 
+    // The engine's delta is d3's tTracked delta under a fixed or RenderStream driven time step, measure the real one
     float DiffTime;
-    if (FApp::IsBenchmarking() || FApp::UseFixedTimeStep())
+    if (FApp::IsBenchmarking() || FApp::UseFixedTimeStep() || URenderStreamCustomTimeStep::IsActive())
     {
         const double CurrentTime = FPlatformTime::Seconds();
         if (m_LastTime == 0)
@@ -1014,38 +1203,82 @@ void FRenderStreamModule::OnEndFrame()
     // Get the time we idled this frame.
     double WaitTime = FThreadIdleStats::Get().Waits;
 
-    Entries.Push({ "Frame Time", DiffTime * 1000.0f });
-    Entries.Push({ "Game Time", FPlatformTime::ToMilliseconds(GGameThreadTime) });
-    Entries.Push({ "Render Time", FPlatformTime::ToMilliseconds(GRenderThreadTime) });
-    Entries.Push({ "RHI Time", FPlatformTime::ToMilliseconds(GRHIThreadTime) });
-    Entries.Push({ "GPU Time", gpuTime });
-    Entries.Push({ "Unreal Idle Time", FPlatformTime::ToMilliseconds(WaitTime) });
+    Telemetry.Record(m_metrics.FrameTime, DiffTime * 1000.0f);
+    Telemetry.Record(m_metrics.GameTime, FPlatformTime::ToMilliseconds(GGameThreadTime));
+    Telemetry.Record(m_metrics.RenderTime, FPlatformTime::ToMilliseconds(GRenderThreadTime));
+    Telemetry.Record(m_metrics.RHITime, FPlatformTime::ToMilliseconds(GRHIThreadTime));
+    Telemetry.Record(m_metrics.GPUTime, gpuTime);
+    Telemetry.Record(m_metrics.IdleTime, FPlatformTime::ToMilliseconds(WaitTime));
 
     // Because their stats api is weird for now we are manually timing this.
     IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
     const bool IsController = !ClusterMgr || ClusterMgr->IsPrimary();
     if (IsController)
-        Entries.Push({ "Await Time", (float)m_syncFrame.AwaitTime });
+        Telemetry.Record(m_metrics.AwaitTime, (float)m_syncFrame.AwaitTime);
     else
-        Entries.Push({ "Receive Time", (float)m_syncFrame.ReceiveTime });
+        Telemetry.Record(m_metrics.ReceiveTime, (float)m_syncFrame.ReceiveTime);
+
+    if (RenderStreamAllocationCounter::IsInstalled())
+        Telemetry.Record(m_metrics.FrameLoopAllocations, float(FrameLoopAllocations));
+
+    uint32 ResponsesDropped = 0;
+    uint32 ResponseMismatches = 0;
+    const int32 NumInfos = NumViewports();
+    for (FRenderStreamViewportHandle Handle = 0; Handle < NumInfos; ++Handle)
+    {
+        ResponsesDropped += m_viewports[Handle].m_frameResponses.ConsumeDropped();
+        ResponseMismatches += m_viewports[Handle].m_frameResponses.ConsumeMismatched();
+    }
+    SET_DWORD_STAT(STAT_CameraResponsesDropped, ResponsesDropped);
+    SET_DWORD_STAT(STAT_CameraResponseMismatches, ResponseMismatches);
+    Telemetry.Record(m_metrics.CameraResponsesDropped, float(ResponsesDropped));
+    Telemetry.Record(m_metrics.CameraResponseMismatches, float(ResponseMismatches));
+
+    RenderStreamLinkInstrumentation::RecordTelemetry();
 
-    RenderStreamLink::instance().rs_sendProfilingData(Entries.GetData(), Entries.Num());
+    Telemetry.EndFrame();
 }
 
-FRenderStreamViewportInfo& FRenderStreamModule::GetViewportInfo(FString const& ViewportId)
+FRenderStreamViewportHandle FRenderStreamModule::InternViewport(FString const& ViewportId)
 {
-    const auto Info = ViewportInfos.Find(ViewportId);
-    if (Info)
-        return *(*Info);
-    
-    return *ViewportInfos.Add(ViewportId, MakeShareable<FRenderStreamViewportInfo>(new FRenderStreamViewportInfo()));
+    check(IsInGameThread());
+    if (const FRenderStreamViewportHandle* Handle = m_viewportHandles.Find(ViewportId))
+        return *Handle;
+
+    const int32 Num = m_numViewports.load(std::memory_order_relaxed);
+    if (Num >= MaxViewports)
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Unable to configure viewport '%s', the limit of %d viewports is reached, restart to reset it"), *ViewportId, MaxViewports);
+        return INDEX_NONE;
+    }
+
+    m_viewports[Num].Id = ViewportId;
+    m_viewportHandles.Add(ViewportId, Num);
+    m_numViewports.store(Num + 1, std::memory_order_release);
+    return Num;
 }
 
-void FRenderStreamModule::PushAnimDataToSource(const RenderStreamLink::FAnimDataKey& Key, const FString& SubjectName, const RenderStreamLink::FSkeletalLayout& Layout, const RenderStreamLink::FSkeletalPose& Pose)
+void FRenderStreamModule::PushAnimDataToSource(const RenderStreamLink::FAnimDataKey& Key, const FName& SubjectName, const RenderStreamLink::FSkeletalLayout& Layout, const RenderStreamLink::FSkeletalPose& Pose)
 {
-    SkeletalParamNames.Emplace(Key, SubjectName);
-    SkeletalLayouts.Emplace(SubjectName, Layout);
-    SkeletalPoses.Emplace(SubjectName, Pose);
+    // Update in place so a stable skeleton doesn't reallocate every frame.
+    const FName* ParamName = SkeletalParamNames.Find(Key);
+    if (!ParamName || *ParamName != SubjectName)
+        SkeletalParamNames.Emplace(Key, SubjectName);
+
+    const RenderStreamLink::FSkeletalLayout* ExistingLayout = SkeletalLayouts.Find(SubjectName);
+    if (!ExistingLayout || ExistingLayout->version != Layout.version || ExistingLayout->joints.Num() != Layout.joints.Num()
+        || FMemory::Memcmp(ExistingLayout->joints.GetData(), Layout.joints.GetData(), Layout.joints.Num() * Layout.joints.GetTypeSize()) != 0)
+    {
+        SkeletalLayouts.Emplace(SubjectName, Layout);
+    }
+
+    RenderStreamLink::FSkeletalPose& ExistingPose = SkeletalPoses.FindOrAdd(SubjectName);
+    ExistingPose.layoutId = Pose.layoutId;
+    ExistingPose.layoutVersion = Pose.layoutVersion;
+    ExistingPose.rootPosition = Pose.rootPosition;
+    ExistingPose.rootOrientation = Pose.rootOrientation;
+    ExistingPose.joints.SetNumUninitialized(Pose.joints.Num(), false);
+    FMemory::Memcpy(ExistingPose.joints.GetData(), Pose.joints.GetData(), Pose.joints.Num() * Pose.joints.GetTypeSize());
 }
 
 const FName* FRenderStreamModule::GetSkeletalParamName(const RenderStreamLink::FAnimDataKey& Key) const
@@ -5,6 +5,7 @@
 #include "Modules/ModuleInterface.h"
 #include "DisplayClusterConfigurationTypes_Viewport.h"
 #include "Cluster/IDisplayClusterClusterManager.h"
+#include <atomic>
 #include <deque>
 #include <memory>
 #include <mutex>
@@ -16,6 +17,9 @@
 #include "Math/UnitConversion.h"
 
 #include "RenderStreamLink.h"
+#include "RenderStreamTelemetry.h"
+#include "RenderStreamFrameResponseRing.h"
+#include "RenderStreamCameraPredictor.h"
 #include "StreamPool.h"
 #include "SyncFrameData.h"
 
@@ -34,15 +38,36 @@ bool IsDX11();
 
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnActorSpawned, AActor*);
 
-struct FRenderStreamViewportInfo
+// Dense index of a viewport's FRenderStreamViewportInfo, interned once when its stream is configured. INDEX_NONE when
+// the viewport isn't a RenderStream one.
+using FRenderStreamViewportHandle = int32;
+
+struct alignas(PLATFORM_CACHE_LINE_SIZE) FRenderStreamViewportInfo
 {
+    FString Id;
     TWeakObjectPtr<ACameraActor> Template = nullptr;
     TWeakObjectPtr<ACameraActor> Camera = nullptr;
     int32_t PlayerId = -1;
     RenderStreamLink::CameraHandle CameraHandleLast = 0;
-    
-    std::mutex m_frameResponsesLock;
-    std::map<uint64, RenderStreamLink::CameraResponseData> m_frameResponsesMap;
+
+    FRenderStreamFrameResponseRing m_frameResponses;
+    uint64 RequestedFrame = 0; // last GFrameCounter d3 requested this viewport's stream, or one of its fragments', on
+    FRenderStreamViewportHandle FragmentLeader = INDEX_NONE; // viewport rendering this one's fragment group, see FStreamFragmentGroup
+    FRenderStreamCameraPredictor m_predictor;
+};
+
+// Engine stat forwarded to d3 as a telemetry metric, selected by URenderStreamSettings::TelemetryStats.
+struct FRenderStreamForwardedStat
+{
+    FName Name;
+    FRenderStreamMetric Metric;
+};
+
+// Whether the cluster is rendering. Idle while d3 isn't requesting frames, see URenderStreamSettings::IdleWhenNotRequested.
+enum class ERenderStreamIdleState : uint8
+{
+    Active,
+    Idle,
 };
 
 class FRenderStreamModule : public IModuleInterface
@@ -64,6 +89,7 @@ protected:
     void AppWillTerminate();
     
     void EnableStats() const;
+    void RegisterMetrics();
 
     TArray<TWeakObjectPtr<ARenderStreamEventHandler>> m_eventHandlers;
 
@@ -73,35 +99,70 @@ public:
 
     static FRenderStreamModule* Get();
     
+    // Called on every node once per frame with the controller's decision. While idle viewport rendering and telemetry
+    // are skipped, and the controller waits in rs_awaitFrameData for the next request.
+    void SetIdle(bool bIdle);
+    bool IsIdle() const { return m_idleState == ERenderStreamIdleState::Idle; }
+
     void LoadSchemas(const UWorld& World);
     void ApplyScene(uint32_t sceneId);
 
     TUniquePtr<FStreamPool> StreamPool;
+    std::vector<uint8_t> m_streamDescMem; // reused by PopulateStreamPool
     FRenderStreamSyncFrameData m_syncFrame;
     std::unique_ptr<RenderStreamSceneSelector> m_sceneSelector;
 
     void ApplyCameras(const RenderStreamLink::FrameData& frameData);
     void ApplyCameraData(FRenderStreamViewportInfo& info, const RenderStreamLink::FrameData& frameData,
-        const RenderStreamLink::CameraData& cameraData);
+        const RenderStreamLink::CameraData& trackedCamera);
+    void UpdateCamera(FRenderStreamViewportInfo& info, const RenderStreamLink::CameraData& cameraData);
 
     void OnModulesChanged(FName ModuleName, EModuleChangeReason ReasonForChange);
     void OnPostLoadMapWithWorld(UWorld* InWorld);
     void OnActorSpawned(AActor* InActor);
     void HideDefaultPawns();
 
-    FRenderStreamViewportInfo& GetViewportInfo(FString const& ViewportId);
+    // Handles are never freed: the nDisplay viewport of a retired stream, and the policy holding its handle, outlive the
+    // stream. Every distinct viewport name seen in a session uses one, so a session in which d3 renames streams more than
+    // MaxViewports times stops configuring new viewports until it is restarted.
+    static constexpr int32 MaxViewports = 256;
+
+    // Game thread, returns the existing handle if the viewport is already interned, INDEX_NONE once MaxViewports is reached.
+    FRenderStreamViewportHandle InternViewport(FString const& ViewportId);
+    FRenderStreamViewportInfo& GetViewportInfo(FRenderStreamViewportHandle Handle) { check(Handle >= 0 && Handle < m_numViewports.load(std::memory_order_acquire)); return m_viewports[Handle]; }
+    int32 NumViewports() const { return m_numViewports.load(std::memory_order_acquire); }
 
-    void PushAnimDataToSource(const RenderStreamLink::FAnimDataKey& Key, const FString& SubjectName, const RenderStreamLink::FSkeletalLayout& Layout, const RenderStreamLink::FSkeletalPose& Pose);
+    void PushAnimDataToSource(const RenderStreamLink::FAnimDataKey& Key, const FName& SubjectName, const RenderStreamLink::FSkeletalLayout& Layout, const RenderStreamLink::FSkeletalPose& Pose);
     const FName* GetSkeletalParamName(const RenderStreamLink::FAnimDataKey& Key) const;
     const RenderStreamLink::FSkeletalLayout* GetSkeletalLayout(const FName& SubjectName) const;
     const RenderStreamLink::FSkeletalPose* GetSkeletalPose(const FName& SubjectName) const;
 
-    TMap<FString, TSharedPtr<FRenderStreamViewportInfo>> ViewportInfos;
+    // Records never move once interned, the rendering thread reads them while the game thread adds more
+    TUniquePtr<FRenderStreamViewportInfo[]> m_viewports = MakeUnique<FRenderStreamViewportInfo[]>(MaxViewports);
+    std::atomic<int32> m_numViewports{ 0 };
+    TMap<FString, FRenderStreamViewportHandle> m_viewportHandles;
     TSharedPtr<FRenderStreamProjectionPolicyFactory> ProjectionPolicyFactory;
     TSharedPtr<FRenderStreamPostProcessFactory> PostProcessFactory;
     TSharedPtr<FRenderStreamLogOutputDevice, ESPMode::ThreadSafe> m_logDevice = nullptr;
+    struct
+    {
+        FRenderStreamMetric FrameTime;
+        FRenderStreamMetric GameTime;
+        FRenderStreamMetric RenderTime;
+        FRenderStreamMetric RHITime;
+        FRenderStreamMetric GPUTime;
+        FRenderStreamMetric IdleTime;
+        FRenderStreamMetric AwaitTime;
+        FRenderStreamMetric ReceiveTime;
+        FRenderStreamMetric FrameLoopAllocations;
+        FRenderStreamMetric CameraResponsesDropped;
+        FRenderStreamMetric CameraResponseMismatches;
+    } m_metrics;
+    TArray<FRenderStreamForwardedStat> m_forwardedStats;
     double m_LastTime = 0;
     bool m_gameInstanceStarted = false;
+    ERenderStreamIdleState m_idleState = ERenderStreamIdleState::Active;
+    FRenderStreamCameraPredictor::FSettings m_cameraPrediction;
     
     TMap<RenderStreamLink::FAnimDataKey, FName> SkeletalParamNames;
     TMap<FName, RenderStreamLink::FSkeletalLayout> SkeletalLayouts;
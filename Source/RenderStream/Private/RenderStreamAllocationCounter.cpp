@@ -0,0 +1,132 @@
+#include "RenderStreamAllocationCounter.h"
+#include "RenderStream.h"
+
+#include "HAL/MemoryBase.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+#include <atomic>
+
+namespace {
+    thread_local int32 GScopeDepth = 0;
+    std::atomic<uint32> GCount{ 0 };
+    std::atomic<bool> GInstalled{ false };
+
+    FORCEINLINE void CountAllocation()
+    {
+        if (GScopeDepth > 0)
+            GCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Forwards everything to the allocator it replaced, so memory allocated before installation is freed correctly.
+    class FCountingMalloc final : public FMalloc
+    {
+    public:
+        explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+        virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->Malloc(Count, Alignment);
+        }
+
+        virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->TryMalloc(Count, Alignment);
+        }
+
+        virtual void* MallocZeroed(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->MallocZeroed(Count, Alignment);
+        }
+
+        virtual void* TryMallocZeroed(SIZE_T Count, uint32 Alignment) override
+        {
+            CountAllocation();
+            return Inner->TryMallocZeroed(Count, Alignment);
+        }
+
+        virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+        {
+            if (Count > 0)
+                CountAllocation();
+            return Inner->Realloc(Original, Count, Alignment);
+        }
+
+        virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+        {
+            if (Count > 0)
+                CountAllocation();
+            return Inner->TryRealloc(Original, Count, Alignment);
+        }
+
+        virtual void Free(void* Original) override { Inner->Free(Original); }
+        virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+        virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+        virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+        virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+        virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+        virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+        virtual void UpdateStats() override { Inner->UpdateStats(); }
+        virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+        virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+        virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+        virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+        virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+        virtual void OnMallocInitialized() override { Inner->OnMallocInitialized(); }
+        virtual void OnPreFork() override { Inner->OnPreFork(); }
+        virtual void OnPostFork() override { Inner->OnPostFork(); }
+
+    private:
+        FMalloc* Inner;
+    };
+}
+
+bool RenderStreamAllocationCounter::IsRequested()
+{
+    return FParse::Param(FCommandLine::Get(), TEXT("RenderStreamAllocCounter"));
+}
+
+void RenderStreamAllocationCounter::Install()
+{
+    if (GInstalled.exchange(true))
+        return;
+
+    // Never removed: blocks allocated through the proxy may be freed at any point until exit.
+    FMalloc* Proxy = new FCountingMalloc(GMalloc);
+    GMalloc = Proxy;
+    UE_LOG(LogRenderStream, Log, TEXT("RenderStream frame loop allocation counter enabled."));
+}
+
+bool RenderStreamAllocationCounter::IsInstalled()
+{
+    return GInstalled.load(std::memory_order_relaxed);
+}
+
+uint32 RenderStreamAllocationCounter::ConsumeCount()
+{
+    return GCount.exchange(0, std::memory_order_relaxed);
+}
+
+FRenderStreamAllocationScope::FRenderStreamAllocationScope()
+{
+    ++GScopeDepth;
+}
+
+FRenderStreamAllocationScope::~FRenderStreamAllocationScope()
+{
+    --GScopeDepth;
+}
+
+FRenderStreamAllocationScopeExclusion::FRenderStreamAllocationScopeExclusion()
+    : SavedDepth(GScopeDepth)
+{
+    GScopeDepth = 0;
+}
+
+FRenderStreamAllocationScopeExclusion::~FRenderStreamAllocationScopeExclusion()
+{
+    GScopeDepth = SavedDepth;
+}
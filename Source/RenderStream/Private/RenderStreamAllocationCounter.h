@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Diagnostic count of heap allocations made by the RenderStream frame loop.
+//
+// Started with -RenderStreamAllocCounter, GMalloc is wrapped by a pass-through proxy that counts allocations made on a
+// thread while it is inside an FRenderStreamAllocationScope. The count per frame is published as STAT_FrameLoopAllocations,
+// which should read zero once streams and schema are stable.
+namespace RenderStreamAllocationCounter
+{
+    bool IsRequested();
+    void Install();
+    bool IsInstalled();
+
+    // Allocations counted since the previous call.
+    uint32 ConsumeCount();
+}
+
+class FRenderStreamAllocationScope
+{
+public:
+    FRenderStreamAllocationScope();
+    ~FRenderStreamAllocationScope();
+};
+
+// Excludes allocations the plugin has no control over (e.g. the engine's render command queue) from an enclosing scope.
+class FRenderStreamAllocationScopeExclusion
+{
+public:
+    FRenderStreamAllocationScopeExclusion();
+    ~FRenderStreamAllocationScopeExclusion();
+
+private:
+    int32 SavedDepth;
+};
@@ -0,0 +1,85 @@
+#include "RenderStreamAwaitScheduler.h"
+
+namespace
+{
+    constexpr double IntervalSmoothing = 0.1;
+    constexpr double JitterSmoothing = 0.2;
+
+    // Deltas further than this from the current interval are pauses or jumps in d3's timeline, not a new cadence
+    constexpr double MaxIntervalChange = 4.0;
+
+    // Missed intervals before d3 is considered to have stopped requesting frames
+    constexpr int32 IdleIntervals = 8;
+}
+
+void FRenderStreamAwaitScheduler::RegisterMetrics()
+{
+    FRenderStreamTelemetry& Telemetry = FRenderStreamTelemetry::Get();
+    m_metrics.Timeout = Telemetry.RegisterMetric(TEXT("Await Timeout"));
+    m_metrics.Late = Telemetry.RegisterMetric(TEXT("Request Late"));
+    m_metrics.Early = Telemetry.RegisterMetric(TEXT("Request Early"));
+    m_metrics.Missing = Telemetry.RegisterMetric(TEXT("Requests Missing"));
+}
+
+double FRenderStreamAwaitScheduler::Deadline() const
+{
+    // Missed intervals move the deadline along rather than measuring every following arrival against the first one
+    return m_lastArrival + m_interval * (1 + m_consecutiveMisses);
+}
+
+int32 FRenderStreamAwaitScheduler::NextTimeout(double Now)
+{
+    int32 TimeoutMs = MaxTimeoutMs;
+    if (HasCadence() && m_hasArrival)
+    {
+        const double Margin = FMath::Max(2.0 * m_jitter, 0.25 * m_interval);
+        const double Backoff = double(1 << FMath::Min(m_consecutiveMisses, 8));
+        const double Timeout = (Deadline() - Now) + Margin * Backoff;
+        TimeoutMs = FMath::Clamp(int32(FMath::CeilToDouble(Timeout * 1000.0)), MinTimeoutMs, MaxTimeoutMs);
+    }
+
+    FRenderStreamTelemetry::Get().Record(m_metrics.Timeout, float(TimeoutMs));
+    return TimeoutMs;
+}
+
+void FRenderStreamAwaitScheduler::OnFrame(const RenderStreamLink::FrameData& FrameData, double ArrivalTime)
+{
+    const double Nominal = FrameData.frameRateNumerator > 0 ? double(FrameData.frameRateDenominator) / FrameData.frameRateNumerator : 0.0;
+
+    if (!HasCadence() || !m_hasArrival)
+    {
+        m_interval = Nominal;
+    }
+    else
+    {
+        const double Lateness = ArrivalTime - Deadline();
+        FRenderStreamTelemetry& Telemetry = FRenderStreamTelemetry::Get();
+        Telemetry.Record(m_metrics.Late, float(FMath::Max(Lateness, 0.0) * 1000.0));
+        Telemetry.Record(m_metrics.Early, float(FMath::Max(-Lateness, 0.0) * 1000.0));
+        m_jitter += (FMath::Abs(Lateness) - m_jitter) * JitterSmoothing;
+
+        const double Delta = FrameData.tTracked - m_lastTracked;
+        if (Delta > m_interval / MaxIntervalChange && Delta < m_interval * MaxIntervalChange)
+            m_interval += (Delta - m_interval) * IntervalSmoothing;
+        else if (Nominal > 0.0)
+            m_interval = Nominal;
+    }
+
+    m_lastArrival = ArrivalTime;
+    m_lastTracked = FrameData.tTracked;
+    m_hasArrival = true;
+    m_consecutiveMisses = 0;
+}
+
+void FRenderStreamAwaitScheduler::OnMissed()
+{
+    ++m_consecutiveMisses;
+    FRenderStreamTelemetry::Get().Record(m_metrics.Missing, float(m_consecutiveMisses));
+}
+
+bool FRenderStreamAwaitScheduler::IsIdle(double Now) const
+{
+    if (!HasCadence() || !m_hasArrival)
+        return true;
+    return Now - m_lastArrival > FMath::Max(IdleIntervals * m_interval, MaxTimeoutMs / 1000.0);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+#include "RenderStreamTelemetry.h"
+
+// Chooses the timeout of each rs_awaitFrameData on the nDisplay controller.
+//
+// The expected interval between requests starts at the frame rate d3 reports and follows the tTracked deltas of the
+// frames that actually arrive, smoothed with an EWMA, together with the jitter of the arrival times. Each await gets a
+// deadline of one interval after the previous arrival, plus a margin for the jitter, and times out at the deadline
+// instead of after a fixed half second. Consecutive misses widen the timeout back up to MaxTimeoutMs so an idle d3 is
+// not polled in a tight loop. Arrivals are recorded as late or early against the deadline, misses as missing.
+class FRenderStreamAwaitScheduler
+{
+public:
+    static constexpr int32 MinTimeoutMs = 2;
+    static constexpr int32 MaxTimeoutMs = 500;
+
+    void RegisterMetrics();
+
+    // Timeout for the next await, from now.
+    int32 NextTimeout(double Now);
+
+    // ArrivalTime is when rs_awaitFrameData returned the frame, which can be earlier than when it was taken.
+    void OnFrame(const RenderStreamLink::FrameData& FrameData, double ArrivalTime);
+    void OnMissed();
+
+    // Nothing has been requested for long enough that d3 is not expected to request more frames soon.
+    bool IsIdle(double Now) const;
+
+private:
+    bool HasCadence() const { return m_interval > 0.0; }
+    double Deadline() const;
+
+    double m_interval = 0.0;  // seconds, EWMA of the tTracked deltas
+    double m_jitter = 0.0;    // seconds, EWMA of the distance between arrivals and their deadline
+    double m_lastArrival = 0.0;
+    double m_lastTracked = 0.0;
+    bool m_hasArrival = false;
+    int32 m_consecutiveMisses = 0;
+
+    struct
+    {
+        FRenderStreamMetric Timeout;
+        FRenderStreamMetric Late;
+        FRenderStreamMetric Early;
+        FRenderStreamMetric Missing;
+    } m_metrics;
+};
@@ -0,0 +1,105 @@
+#include "RenderStreamCameraPredictor.h"
+
+namespace
+{
+    double UnwrapDegrees(double Delta)
+    {
+        return FMath::Fmod(Delta + 540.0, 360.0) - 180.0;
+    }
+
+    // Sample B relative to A, rotations taken the short way round
+    void Difference(const double (&A)[6], const double (&B)[6], double (&Out)[6])
+    {
+        for (int32 i = 0; i < 3; ++i)
+            Out[i] = B[i] - A[i];
+        for (int32 i = 3; i < 6; ++i)
+            Out[i] = UnwrapDegrees(B[i] - A[i]);
+    }
+}
+
+FRenderStreamCameraPredictor::FSettings FRenderStreamCameraPredictor::ReadSettings(const URenderStreamSettings& Settings)
+{
+    FSettings Out;
+    Out.Mode = Settings.CameraPrediction;
+    Out.Horizon = FMath::Max(Settings.CameraPredictionHorizon, 0.f) / 1000.0;
+    Out.MaxSpeed = Settings.CameraPredictionMaxSpeed;
+    Out.MaxAngularSpeed = Settings.CameraPredictionMaxAngularSpeed;
+    return Out;
+}
+
+RenderStreamLink::CameraData FRenderStreamCameraPredictor::Predict(const RenderStreamLink::CameraData& Tracked, double TTracked, const FSettings& Settings)
+{
+    if (Settings.Mode == ERenderStreamCameraPrediction::None || Tracked.cameraHandle == 0)
+    {
+        Reset();
+        return Tracked;
+    }
+
+    FSample Current = { TTracked, { Tracked.x, Tracked.y, Tracked.z, Tracked.rx, Tracked.ry, Tracked.rz } };
+
+    // Restart the history on a cut, a repeated or reversed timestamp, or a jump no real camera makes
+    bool bRestart = m_count == 0 || Tracked.cameraHandle != m_camera;
+    if (!bRestart)
+    {
+        const FSample& Last = Sample(0);
+        const double Dt = TTracked - Last.T;
+        if (Dt <= 0.0)
+        {
+            bRestart = Dt < 0.0;
+            if (!bRestart)
+                return m_predicted; // same frame applied again, the history already has it
+        }
+        else
+        {
+            double Delta[6];
+            Difference(Last.Pose, Current.Pose, Delta);
+            const double Speed = FMath::Sqrt(Delta[0] * Delta[0] + Delta[1] * Delta[1] + Delta[2] * Delta[2]) / Dt;
+            const double AngularSpeed = FMath::Max3(FMath::Abs(Delta[3]), FMath::Abs(Delta[4]), FMath::Abs(Delta[5])) / Dt;
+            bRestart = (Settings.MaxSpeed > 0.0 && Speed > Settings.MaxSpeed)
+                || (Settings.MaxAngularSpeed > 0.0 && AngularSpeed > Settings.MaxAngularSpeed);
+        }
+    }
+
+    if (bRestart)
+        m_count = 0;
+    m_camera = Tracked.cameraHandle;
+    m_head = (m_head + 1) % HistorySize;
+    m_history[m_head] = Current;
+    m_count = FMath::Min(m_count + 1, HistorySize);
+
+    m_predicted = Tracked;
+    if (m_count < 2 || Settings.Horizon <= 0.0)
+        return m_predicted;
+
+    // Velocity over the last interval, and with three samples its change over the previous one
+    const FSample& S1 = Sample(1);
+    const double Dt1 = Current.T - S1.T;
+    double Velocity[6];
+    Difference(S1.Pose, Current.Pose, Velocity);
+    for (double& V : Velocity)
+        V /= Dt1;
+
+    double Acceleration[6] = {};
+    if (Settings.Mode == ERenderStreamCameraPrediction::ConstantAcceleration && m_count >= 3)
+    {
+        const FSample& S2 = Sample(2);
+        const double Dt2 = S1.T - S2.T;
+        double Previous[6];
+        Difference(S2.Pose, S1.Pose, Previous);
+        for (int32 i = 0; i < 6; ++i)
+            Acceleration[i] = (Velocity[i] - Previous[i] / Dt2) / (0.5 * (Dt1 + Dt2));
+    }
+
+    const double H = Settings.Horizon;
+    double Predicted[6];
+    for (int32 i = 0; i < 6; ++i)
+        Predicted[i] = Current.Pose[i] + Velocity[i] * H + 0.5 * Acceleration[i] * H * H;
+
+    m_predicted.x = float(Predicted[0]);
+    m_predicted.y = float(Predicted[1]);
+    m_predicted.z = float(Predicted[2]);
+    m_predicted.rx = float(Predicted[3]);
+    m_predicted.ry = float(Predicted[4]);
+    m_predicted.rz = float(Predicted[5]);
+    return m_predicted;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+#include "RenderStreamSettings.h"
+
+// Extrapolates a tracked camera pose to the time the frame rendered from it is displayed.
+//
+// Keeps the last few poses of one viewport's camera with their tTracked and fits either a constant velocity through the
+// last two or a constant acceleration through the last three. Rotations are extrapolated per Euler angle with the deltas
+// unwrapped. A sample that implies a speed above the configured limits, goes back in time or belongs to another camera
+// restarts the history, so a cut or a tracking glitch is applied as received instead of flung forward.
+class FRenderStreamCameraPredictor
+{
+public:
+    struct FSettings
+    {
+        ERenderStreamCameraPrediction Mode = ERenderStreamCameraPrediction::None;
+        double Horizon = 0.0;         // seconds past tTracked
+        double MaxSpeed = 0.0;        // meters per second
+        double MaxAngularSpeed = 0.0; // degrees per second
+    };
+
+    static FSettings ReadSettings(const URenderStreamSettings& Settings);
+
+    // Records the tracked pose and returns it extrapolated by the horizon, or unchanged when prediction is off or the
+    // history is too short.
+    RenderStreamLink::CameraData Predict(const RenderStreamLink::CameraData& Tracked, double TTracked, const FSettings& Settings);
+
+    void Reset() { m_count = 0; }
+
+private:
+    static constexpr int32 HistorySize = 3;
+
+    struct FSample
+    {
+        double T;
+        double Pose[6]; // x, y, z, rx, ry, rz
+    };
+
+    const FSample& Sample(int32 Age) const { return m_history[(m_head - Age + HistorySize) % HistorySize]; }
+
+    FSample m_history[HistorySize] = {};
+    int32 m_head = 0;
+    int32 m_count = 0;
+    RenderStreamLink::CameraHandle m_camera = 0;
+    RenderStreamLink::CameraData m_predicted = {};
+};
@@ -7,6 +7,8 @@
 #include "FrameStream.h"
 #include "IDisplayCluster.h"
 #include "RenderStream.h"
+#include "RenderStreamSettings.h"
+#include "RenderStreamAllocationCounter.h"
 #include "RenderStreamProjectionPolicy.h"
 #include "Render/Viewport/IDisplayClusterViewportManager.h"
 #include "Render/Viewport/IDisplayClusterViewportProxy.h"
@@ -19,6 +21,31 @@ DEFINE_LOG_CATEGORY(LogRenderStreamPostProcess);
 
 FString FRenderStreamCapturePostProcess::Type = TEXT("renderstream_capture");
 
+namespace
+{
+    // False when the stream wasn't requested this frame, so it shouldn't be sent.
+    bool TakeFrameResponse(FRenderStreamModule& Module, const FFrameStream& Stream, RenderStreamLink::CameraResponseData& OutFrameResponse)
+    {
+        // Interned with the stream's configuration, which happens on the game thread before its viewport renders
+        const FRenderStreamViewportHandle ViewportHandle = Stream.ViewportHandle();
+        if (ViewportHandle != INDEX_NONE && Module.GetViewportInfo(ViewportHandle).m_frameResponses.Take(GFrameCounterRenderThread, OutFrameResponse))
+            return true;
+
+        // Not requested this frame, so it wasn't rendered either
+        if (GetDefault<URenderStreamSettings>()->RenderOnDemand)
+            return false;
+
+        // default values to avoid any math assertions in debug dlls
+        OutFrameResponse = {};
+        OutFrameResponse.camera.nearZ = 0.1f;
+        OutFrameResponse.camera.farZ = 1.f;
+        OutFrameResponse.camera.sensorX = 1.f;
+        OutFrameResponse.camera.sensorY = 1.f;
+        OutFrameResponse.camera.focalLength = 1.f;
+        return true;
+    }
+}
+
 FRenderStreamCapturePostProcess::FRenderStreamCapturePostProcess(const FString& PostProcessId, const struct FDisplayClusterConfigurationPostprocess* InConfigurationPostProcess)
     : Id(PostProcessId)
 {}
@@ -54,7 +81,9 @@ void FRenderStreamCapturePostProcess::PerformPostProcessViewAfterWarpBlend_Rende
         return;
     }
 
-    auto ViewportId = ViewportProxy->GetId();
+    FRenderStreamAllocationScope AllocationScope;
+
+    const FString& ViewportId = ViewportProxy->GetId();
     FRenderStreamModule* Module = FRenderStreamModule::Get();
     check(Module);
 
@@ -62,6 +91,12 @@ void FRenderStreamCapturePostProcess::PerformPostProcessViewAfterWarpBlend_Rende
     // We can't create a stream on the render thread, so our only option is to not do anything if the stream doesn't exist here.
     if (Stream)
     {
+        // Fragments of a group aren't rendered, the group's leader sends them cropped from its own render. The groups are
+        // the ones this frame was drawn with, the game thread may have regrouped since.
+        const FStreamFragmentGroup* Group = Module->StreamPool->GetFrameFragmentGroup_RenderThread(ViewportId);
+        if (Group && Group->Leader != Stream)
+            return;
+
         auto Size = ViewportProxy->GetRenderSettings_RenderThread().Rect.Size();
         if (Size.GetMin() <= 0)
         {
@@ -71,31 +106,14 @@ void FRenderStreamCapturePostProcess::PerformPostProcessViewAfterWarpBlend_Rende
             return;
         }
 
-        auto& Info = Module->GetViewportInfo(ViewportId);
-        RenderStreamLink::CameraResponseData frameResponse;
-        {
-            std::lock_guard<std::mutex> guard(Info.m_frameResponsesLock);
-            if (Info.m_frameResponsesMap.count(GFrameCounterRenderThread)) // Check current frame data exists
-            {
-                frameResponse = Info.m_frameResponsesMap[GFrameCounterRenderThread];
-                Info.m_frameResponsesMap.erase(GFrameCounterRenderThread);
-            }
-            else
-            {
-                // default values to avoid any math assertions in debug dlls
-                frameResponse.camera.nearZ = 0.1f;
-                frameResponse.camera.farZ = 1.f;
-                frameResponse.camera.sensorX = 1.f;
-                frameResponse.camera.sensorY = 1.f;
-                frameResponse.camera.focalLength = 1.f;
-            }
-        }
-
-        TArray<FRHITexture*> Resources;
-        TArray<FIntRect> Rects;
+        // Only used on the rendering thread, kept around so sending doesn't allocate.
+        static TArray<FRHITexture*> Resources;
+        static TArray<FIntRect> Rects;
+        Resources.Reset();
+        Rects.Reset();
         // NOTE: If you get a black screen on the stream when updating the plugin to a new unreal version try changing the EDisplayClusterViewportResourceType enum.
         EDisplayClusterViewportResourceType resourceType = EDisplayClusterViewportResourceType::InputShaderResource;
-        const FString policyType = ViewportProxy->GetProjectionPolicy_RenderThread()->GetType();
+        const FString& policyType = ViewportProxy->GetProjectionPolicy_RenderThread()->GetType();
         if (policyType != FRenderStreamProjectionPolicy::RenderStreamPolicyType)
         {
             resourceType = EDisplayClusterViewportResourceType::AdditionalTargetableResource;
@@ -107,7 +125,35 @@ void FRenderStreamCapturePostProcess::PerformPostProcessViewAfterWarpBlend_Rende
             return;
         }
 
-        Stream->SendFrame_RenderingThread(RHICmdList, frameResponse, Resources[0], Rects[0]);
+        if (!Group)
+        {
+            RenderStreamLink::CameraResponseData frameResponse;
+            if (TakeFrameResponse(*Module, *Stream, frameResponse))
+                Stream->SendFrame_RenderingThread(RHICmdList, frameResponse, Resources[0], Rects[0]);
+            return;
+        }
+
+        // Fragment whose texture holds each output blitted this frame, by FFragment::Source
+        TArray<int32, TInlineAllocator<16>> Blitted;
+        Blitted.Init(INDEX_NONE, Group->Fragments.Num());
+        for (int32 i = 0; i < Group->Fragments.Num(); ++i)
+        {
+            const FStreamFragmentGroup::FFragment& Fragment = Group->Fragments[i];
+            RenderStreamLink::CameraResponseData frameResponse;
+            if (!TakeFrameResponse(*Module, *Fragment.Stream, frameResponse))
+                continue;
+
+            int32& BlittedBy = Blitted[Fragment.Source];
+            if (BlittedBy == INDEX_NONE)
+            {
+                Fragment.Stream->SendFrame_RenderingThread(RHICmdList, frameResponse, Resources[0], Rects[0], Fragment.Crop);
+                BlittedBy = i;
+            }
+            else
+            {
+                Fragment.Stream->SendDuplicate_RenderingThread(RHICmdList, frameResponse, *Group->Fragments[BlittedBy].Stream);
+            }
+        }
     }
 
     // Uncomment this to restore client display
@@ -0,0 +1,82 @@
+#include "RenderStreamCustomTimeStep.h"
+
+#include "RenderStream.h"
+#include "RenderStreamAllocationCounter.h"
+
+#include "Engine/Engine.h"
+#include "IDisplayCluster.h"
+#include "Misc/App.h"
+
+URenderStreamCustomTimeStep::URenderStreamCustomTimeStep(const class FObjectInitializer& objectInitializer)
+    : Super(objectInitializer)
+{
+}
+
+bool URenderStreamCustomTimeStep::Initialize(UEngine* InEngine)
+{
+    // The engine clock is driven from here from now on, not by the fixed time step ControllerReceive used to set
+    FApp::SetUseFixedTimeStep(false);
+    return true;
+}
+
+void URenderStreamCustomTimeStep::Shutdown(UEngine* InEngine)
+{
+}
+
+bool URenderStreamCustomTimeStep::UpdateTimeStep(UEngine* InEngine)
+{
+    FRenderStreamModule* Module = FRenderStreamModule::Get();
+    if (!Module || !IsInCluster() || !RenderStreamLink::instance().isAvailable())
+        return true; // not running under d3, let the engine keep its own time
+
+    UpdateApplicationLastTime();
+
+    IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
+    const bool IsController = !ClusterMgr || ClusterMgr->IsPrimary();
+
+    const double WaitStart = FPlatformTime::Seconds();
+    if (IsController)
+    {
+        FRenderStreamAllocationScope AllocationScope;
+        Module->m_syncFrame.ControllerReceive();
+    }
+    const double Now = FPlatformTime::Seconds();
+
+    // Followers have their time replaced by the controller's during the nDisplay sync, as does a controller that has not
+    // received a frame yet and so has no delta to follow
+    const double DeltaSeconds = Module->m_syncFrame.DeltaSeconds;
+    if (IsController && DeltaSeconds > 0.0)
+    {
+        FApp::SetDeltaTime(DeltaSeconds);
+        FApp::SetCurrentTime(FApp::GetLastTime() + DeltaSeconds);
+    }
+    else
+    {
+        FApp::SetDeltaTime(Now - FApp::GetLastTime());
+        FApp::SetCurrentTime(Now);
+    }
+    FApp::SetIdleTime(Now - WaitStart);
+    FApp::SetIdleTimeOvershoot(0.0);
+
+    return false;
+}
+
+ECustomTimeStepSynchronizationState URenderStreamCustomTimeStep::GetSynchronizationState() const
+{
+    if (!RenderStreamLink::instance().isAvailable())
+        return ECustomTimeStepSynchronizationState::Closed;
+
+    const FRenderStreamModule* Module = FRenderStreamModule::Get();
+    return Module && Module->m_syncFrame.m_frameDataValid ? ECustomTimeStepSynchronizationState::Synchronized : ECustomTimeStepSynchronizationState::Synchronizing;
+}
+
+FQualifiedFrameTime URenderStreamCustomTimeStep::GetQualifiedFrameTime() const
+{
+    const FRenderStreamModule* Module = FRenderStreamModule::Get();
+    return Module ? Module->m_syncFrame.FrameTime : FQualifiedFrameTime();
+}
+
+bool URenderStreamCustomTimeStep::IsActive()
+{
+    return GEngine && Cast<URenderStreamCustomTimeStep>(GEngine->GetCustomTimeStep()) != nullptr;
+}
@@ -0,0 +1,92 @@
+#include "RenderStreamFrameAcquisition.h"
+#include "RenderStream.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+
+FRenderStreamFrameAcquisition::FRenderStreamFrameAcquisition()
+{
+    m_published = FPlatformProcess::GetSynchEventFromPool(false);
+    m_released = FPlatformProcess::GetSynchEventFromPool(false);
+    m_thread = FRunnableThread::Create(this, TEXT("RenderStreamFrameAcquisition"), 0, TPri_AboveNormal);
+}
+
+FRenderStreamFrameAcquisition::~FRenderStreamFrameAcquisition()
+{
+    // Deleting the thread stops it, waiting for an await in progress to return
+    delete m_thread;
+    m_thread = nullptr;
+
+    FPlatformProcess::ReturnSynchEventToPool(m_published);
+    FPlatformProcess::ReturnSynchEventToPool(m_released);
+}
+
+RenderStreamLink::RS_ERROR FRenderStreamFrameAcquisition::Take(RenderStreamLink::FrameData& OutFrameData, double& OutArrivalTime, uint32 TimeoutMs)
+{
+    const double Deadline = FPlatformTime::Seconds() + TimeoutMs / 1000.0;
+    for (;;)
+    {
+        uint8 Expected = Slot_Full;
+        if (m_slot.compare_exchange_strong(Expected, Slot_Taken, std::memory_order_acquire))
+        {
+            OutFrameData = m_frameData;
+            OutArrivalTime = m_arrivalTime;
+            return m_result;
+        }
+
+        if (m_quit.load(std::memory_order_acquire))
+            return RenderStreamLink::RS_ERROR_QUIT;
+
+        const double Remaining = Deadline - FPlatformTime::Seconds();
+        if (Remaining <= 0.0)
+            return RenderStreamLink::RS_ERROR_TIMEOUT;
+
+        m_published->Wait(FMath::Max(1, int32(Remaining * 1000.0)));
+    }
+}
+
+void FRenderStreamFrameAcquisition::Release()
+{
+    uint8 Expected = Slot_Taken;
+    if (m_slot.compare_exchange_strong(Expected, Slot_Empty, std::memory_order_release))
+        m_released->Trigger();
+}
+
+void FRenderStreamFrameAcquisition::Publish(RenderStreamLink::RS_ERROR Result, const RenderStreamLink::FrameData& FrameData, double ArrivalTime)
+{
+    // Only the thread moves the slot out of Empty, and it only awaits while the slot is Empty
+    check(m_slot.load(std::memory_order_relaxed) == Slot_Empty);
+    m_slot.store(Slot_Writing, std::memory_order_relaxed);
+    m_result = Result;
+    m_frameData = FrameData;
+    m_arrivalTime = ArrivalTime;
+    m_slot.store(Slot_Full, std::memory_order_release);
+    m_published->Trigger();
+}
+
+uint32 FRenderStreamFrameAcquisition::Run()
+{
+    RenderStreamLink::FrameData FrameData = {};
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        // Awaiting moves RenderStream on to the next frame, wait until the last one has been taken and released
+        if (m_slot.load(std::memory_order_acquire) != Slot_Empty || m_quit.load(std::memory_order_relaxed))
+        {
+            m_released->Wait(50);
+            continue;
+        }
+
+        const RenderStreamLink::RS_ERROR Result = RenderStreamLink::instance().rs_awaitFrameData(m_awaitTimeoutMs.load(std::memory_order_relaxed), &FrameData);
+        if (Result == RenderStreamLink::RS_ERROR_QUIT)
+            m_quit.store(true, std::memory_order_release);
+        Publish(Result, FrameData, FPlatformTime::Seconds());
+    }
+    return 0;
+}
+
+void FRenderStreamFrameAcquisition::Stop()
+{
+    m_stop.store(true, std::memory_order_relaxed);
+    m_released->Trigger();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "HAL/Runnable.h"
+#include "RenderStreamLink.h"
+
+#include <atomic>
+
+class FEvent;
+class FRunnableThread;
+
+// Waits in rs_awaitFrameData on a dedicated thread so the wait for the next frame overlaps the game thread's work on the
+// current one.
+//
+// The thread awaits into a local and hands the frame over through a single slot whose state is one atomic: Empty, Writing
+// (the thread is publishing), Full, or Taken (the game thread is applying it). RenderStream only exposes the data of the
+// most recently awaited frame, so an await only starts while the slot is Empty: the controller takes a frame at the start
+// of its tick, applies it (which queries parameters and cameras), then releases it and the thread starts waiting for the
+// next one. rs_awaitFrameData never runs alongside those queries and every frame d3 hands out is applied in order.
+// Followers are unaffected, they still receive the controller's frame through the nDisplay sync object.
+class FRenderStreamFrameAcquisition : public FRunnable
+{
+public:
+    FRenderStreamFrameAcquisition();
+    ~FRenderStreamFrameAcquisition();
+
+    // Game thread. Returns the frame in the slot, or waits up to TimeoutMs for one, and when rs_awaitFrameData returned it.
+    // A frame taken is held until Release, Release after a timeout does nothing.
+    RenderStreamLink::RS_ERROR Take(RenderStreamLink::FrameData& OutFrameData, double& OutArrivalTime, uint32 TimeoutMs);
+    void Release();
+
+    // Timeout of the rs_awaitFrameData calls made by the thread.
+    void SetAwaitTimeout(int Milliseconds) { m_awaitTimeoutMs.store(Milliseconds, std::memory_order_relaxed); }
+
+private:
+    enum ESlot : uint8
+    {
+        Slot_Empty,
+        Slot_Writing,
+        Slot_Full,
+        Slot_Taken,
+    };
+
+    virtual uint32 Run() override;
+    virtual void Stop() override;
+
+    // Thread. Called with the slot Empty.
+    void Publish(RenderStreamLink::RS_ERROR Result, const RenderStreamLink::FrameData& FrameData, double ArrivalTime);
+
+    std::atomic<uint8> m_slot{ Slot_Empty };
+    RenderStreamLink::RS_ERROR m_result = RenderStreamLink::RS_ERROR_TIMEOUT; // written while Writing, read while Taken
+    RenderStreamLink::FrameData m_frameData = {};
+    double m_arrivalTime = 0.0;
+    std::atomic<bool> m_quit{ false }; // RenderStream asked to quit, nothing more to await
+
+    std::atomic<int> m_awaitTimeoutMs{ 500 };
+    std::atomic<bool> m_stop{ false };
+    FEvent* m_published = nullptr;
+    FEvent* m_released = nullptr;
+    FRunnableThread* m_thread = nullptr;
+};
@@ -0,0 +1,67 @@
+#include "RenderStreamFrameBundle.h"
+
+#include "FrameStream.h"
+#include "RenderStreamSceneSelector.h"
+#include "RenderStreamSettings.h"
+#include "StreamPool.h"
+
+bool FRenderStreamFrameBundle::IsEnabled()
+{
+    return GetDefault<URenderStreamSettings>()->DistributeFrameBundle;
+}
+
+void FRenderStreamFrameBundle::CollectCameras(FStreamPool& Pool)
+{
+    m_cameras.Reset();
+    for (const FFrameStreamPtr& Stream : Pool.GetAllStreams())
+    {
+        if (!Stream)
+            continue;
+
+        FStreamCamera& Entry = m_cameras.AddUninitialized_GetRef();
+        Entry.Handle = Stream->Handle();
+        if (RenderStreamLink::instance().rs_getFrameCamera(Entry.Handle, &Entry.Camera) != RenderStreamLink::RS_ERROR_SUCCESS)
+            m_cameras.Pop(false);
+    }
+}
+
+const RenderStreamLink::CameraData* FRenderStreamFrameBundle::FindCamera(RenderStreamLink::StreamHandle Handle) const
+{
+    for (const FStreamCamera& Entry : m_cameras)
+    {
+        if (Entry.Handle == Handle)
+            return &Entry.Camera;
+    }
+    return nullptr;
+}
+
+void FRenderStreamFrameBundle::Serialize(FArchive& Ar, FFrameParameterBlock* Parameters)
+{
+    int32 NumCameras = m_cameras.Num();
+    Ar << NumCameras;
+    if (Ar.IsLoading())
+    {
+        if (NumCameras < 0 || NumCameras * int64(sizeof(FStreamCamera)) > Ar.TotalSize() - Ar.Tell())
+        {
+            Ar.SetError();
+            m_cameras.Reset();
+            return;
+        }
+        m_cameras.SetNumUninitialized(NumCameras, false);
+    }
+    Ar.Serialize(m_cameras.GetData(), NumCameras * sizeof(FStreamCamera));
+
+    // Parameters are the last section, a follower without a scene selector simply ignores them
+    bool bHasParameters = Parameters != nullptr;
+    Ar << bHasParameters;
+    if (bHasParameters && Parameters)
+        Parameters->SerializeBundle(Ar);
+
+    if (Ar.IsError())
+        m_cameras.Reset();
+}
+
+void FRenderStreamFrameBundle::Reset()
+{
+    m_cameras.Reset();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+
+class FArchive;
+class FFrameParameterBlock;
+class FStreamPool;
+
+// Everything a node reads from RenderStream to apply a frame: the parameter block of the current scene and the camera of
+// every stream.
+//
+// With URenderStreamSettings::DistributeFrameBundle set, the nDisplay controller collects the bundle once and sends it
+// with the cluster sync payload, so followers apply exactly the controller's values without querying d3 themselves.
+// Followers still call rs_beginFollowerFrame, and fall back to querying d3 for anything missing from the bundle.
+class FRenderStreamFrameBundle
+{
+public:
+    static bool IsEnabled();
+
+    // Controller: queries the camera of every stream in the pool, replacing the cameras of the previous frame.
+    void CollectCameras(FStreamPool& Pool);
+
+    // The camera collected or received for this frame, null when the bundle has none for the stream.
+    const RenderStreamLink::CameraData* FindCamera(RenderStreamLink::StreamHandle Handle) const;
+
+    // Saves or loads the bundle. Parameters may be null when no scene selector is active.
+    void Serialize(FArchive& Ar, FFrameParameterBlock* Parameters);
+
+    void Reset();
+
+private:
+    struct FStreamCamera
+    {
+        RenderStreamLink::StreamHandle Handle;
+        RenderStreamLink::CameraData Camera;
+    };
+
+    TArray<FStreamCamera> m_cameras;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+
+#include <atomic>
+
+// Camera responses of the last few frames of one viewport, keyed by frame counter.
+//
+// The game thread writes the response for GFrameCounter when it applies the camera, and the rendering thread takes the
+// response for GFrameCounterRenderThread when it sends the frame. Each slot is a seqlock: neither side ever waits on the
+// other, and a read that races with a newer frame being written to the same slot retries rather than returning a torn
+// response. Memory is fixed. A response that is never taken is overwritten Capacity frames later and counted as dropped,
+// and a take that finds a later frame in its slot is counted as a mismatch between the two frame counters. An earlier
+// frame only means nothing was written for this one, the viewport wasn't requested.
+class FRenderStreamFrameResponseRing
+{
+public:
+    static constexpr uint32 Capacity = 8; // frames, must be a power of two
+
+    // Game thread.
+    void Write(uint64 Frame, const RenderStreamLink::CameraResponseData& Response)
+    {
+        FSlot& Slot = m_slots[Frame & (Capacity - 1)];
+
+        const uint64 Previous = Slot.Frame.load(std::memory_order_relaxed);
+        if (Previous != 0 && Previous != Frame && Slot.Taken.load(std::memory_order_relaxed) != Previous)
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+
+        const uint32 Sequence = Slot.Sequence.load(std::memory_order_relaxed);
+        Slot.Sequence.store(Sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Slot.Frame.store(Frame, std::memory_order_relaxed);
+        Slot.Response = Response;
+        Slot.Sequence.store(Sequence + 2, std::memory_order_release);
+    }
+
+    // Any thread. False when the response for Frame is not in the ring.
+    bool Read(uint64 Frame, RenderStreamLink::CameraResponseData& OutResponse) const
+    {
+        const FSlot& Slot = m_slots[Frame & (Capacity - 1)];
+        for (;;)
+        {
+            const uint32 Sequence = Slot.Sequence.load(std::memory_order_acquire);
+            if (Sequence & 1)
+                continue; // the slot is being written, which only takes a copy
+
+            if (Slot.Frame.load(std::memory_order_relaxed) != Frame)
+                return false;
+
+            OutResponse = Slot.Response;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (Slot.Sequence.load(std::memory_order_relaxed) == Sequence)
+                return true;
+        }
+    }
+
+    // Rendering thread. Reads the response for Frame and marks it as consumed.
+    bool Take(uint64 Frame, RenderStreamLink::CameraResponseData& OutResponse)
+    {
+        if (!Read(Frame, OutResponse))
+        {
+            if (m_slots[Frame & (Capacity - 1)].Frame.load(std::memory_order_relaxed) > Frame)
+                m_mismatched.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        m_slots[Frame & (Capacity - 1)].Taken.store(Frame, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Counts since the last call.
+    uint32 ConsumeDropped() { return m_dropped.exchange(0, std::memory_order_relaxed); }
+    uint32 ConsumeMismatched() { return m_mismatched.exchange(0, std::memory_order_relaxed); }
+
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    struct FSlot
+    {
+        std::atomic<uint32> Sequence{ 0 }; // odd while the slot is being written
+        std::atomic<uint64> Frame{ 0 };
+        std::atomic<uint64> Taken{ 0 };    // last frame the rendering thread consumed from this slot
+        RenderStreamLink::CameraResponseData Response = {};
+    };
+
+    FSlot m_slots[Capacity];
+    std::atomic<uint32> m_dropped{ 0 };
+    std::atomic<uint32> m_mismatched{ 0 };
+};
@@ -0,0 +1,80 @@
+#include "RenderStreamFrameSubmission.h"
+#include "RenderStream.h"
+
+#include "RHICommandList.h"
+#include "ProfilingDebugging/RealtimeGPUProfiler.h"
+
+FRenderStreamFrameSubmission& FRenderStreamFrameSubmission::Get()
+{
+    static FRenderStreamFrameSubmission Submission;
+    return Submission;
+}
+
+void FRenderStreamFrameSubmission::Add(RenderStreamLink::StreamHandle Handle, const RenderStreamLink::SenderFrame& Data, const RenderStreamLink::CameraResponseData& FrameData, bool bFlush, FRHIGPUFence* SentFence)
+{
+    check(IsInRenderingThread());
+    m_batch.Add({ Handle, Data, FrameData });
+    m_flush |= bFlush;
+    if (SentFence)
+        m_fences.Add(SentFence);
+}
+
+void FRenderStreamFrameSubmission::Submit_RenderingThread(FRHICommandListImmediate& RHICmdList)
+{
+    check(IsInRenderingThread());
+    if (m_batch.Num() == 0)
+        return;
+
+    // Only on D3D11 does d3 read through the immediate context the RHI thread records into, so sends from the RHI thread
+    // are ordered after the blits. On D3D12 d3 submits its copies to UE's queue and on Vulkan it reads the memory itself,
+    // both need the blits submitted to the GPU before rs_sendFrame2, which one flush does for the whole frame.
+    if (IsDX11() && !m_flush)
+    {
+        RHICmdList.EnqueueLambda([Batch = MoveTemp(m_batch)](FRHICommandListImmediate&)
+        {
+            Send(Batch);
+        });
+    }
+    else
+    {
+        {
+            SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("RS Flush"));
+            RHICmdList.ImmediateFlush(EImmediateFlushType::FlushRHIThreadFlushResources);
+        }
+        SCOPED_DRAW_EVENTF(RHICmdList, MediaCapture, TEXT("rs_sendFrame2"));
+        Send(m_batch);
+    }
+
+    // Recorded behind the sends, so they are submitted after the reads d3 queued and signal once those are done too
+    for (const FGPUFenceRHIRef& Fence : m_fences)
+    {
+        Fence->Clear();
+        RHICmdList.WriteGPUFence(Fence);
+    }
+
+    m_batch.Reset();
+    m_fences.Reset();
+    m_flush = false;
+}
+
+void FRenderStreamFrameSubmission::Discard_RenderingThread()
+{
+    check(IsInRenderingThread());
+    m_batch.Reset();
+    m_fences.Reset();
+    m_flush = false;
+}
+
+void FRenderStreamFrameSubmission::Send(const FBatch& Batch)
+{
+    for (const FEntry& Entry : Batch)
+    {
+        RenderStreamLink::FrameResponseData Response = {};
+        Response.cameraData = &Entry.FrameData;
+        auto output = RenderStreamLink::instance().rs_sendFrame2(Entry.Handle, &Entry.Data, &Response);
+        if (output != RenderStreamLink::RS_ERROR_SUCCESS)
+        {
+            UE_LOG(LogRenderStream, Log, TEXT("Failed to send frame: %d"), output);
+        }
+    }
+}
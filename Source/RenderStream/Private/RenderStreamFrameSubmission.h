@@ -0,0 +1,46 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+#include "RHIResources.h"
+
+class FRHICommandListImmediate;
+
+// Hands every stream's frame to d3 at the end of the frame instead of once per viewport.
+//
+// The capture post-process records each stream's blit and adds its frame here. Once every viewport is done the module
+// submits the batch: a single flush for the whole frame, then every frame sent back to back. On D3D11, where d3's reads
+// are ordered after UE's work on the immediate context, the sends run on the RHI thread after the blits instead, unless a
+// stream needs the flush anyway.
+class FRenderStreamFrameSubmission
+{
+public:
+    static FRenderStreamFrameSubmission& Get();
+
+    // Rendering thread, once the blit into Data's texture is recorded. bFlush when the texture may be rewritten before the
+    // RHI thread reaches the send, see FFrameStream::SendFrame_RenderingThread. SentFence is cleared and written after
+    // the batch's sends, so it signals once d3's reads queued behind them are done.
+    void Add(RenderStreamLink::StreamHandle Handle, const RenderStreamLink::SenderFrame& Data, const RenderStreamLink::CameraResponseData& FrameData, bool bFlush, FRHIGPUFence* SentFence = nullptr);
+
+    // Rendering thread, after every viewport of the frame.
+    void Submit_RenderingThread(FRHICommandListImmediate& RHICmdList);
+
+    // Rendering thread, at shutdown. Drops frames that were added but not submitted.
+    void Discard_RenderingThread();
+
+private:
+    struct FEntry
+    {
+        RenderStreamLink::StreamHandle Handle;
+        RenderStreamLink::SenderFrame Data;
+        RenderStreamLink::CameraResponseData FrameData;
+    };
+
+    // Inline so handing a batch to the RHI thread doesn't allocate for typical stream counts
+    using FBatch = TArray<FEntry, TInlineAllocator<16>>;
+
+    static void Send(const FBatch& Batch);
+
+    FBatch m_batch;
+    TArray<FGPUFenceRHIRef, TInlineAllocator<16>> m_fences;
+    bool m_flush = false;
+};
@@ -2,6 +2,9 @@
 #include "RenderStream.h"
 
 #include "RenderStreamSettings.h"
+#include "RenderStreamLoopback.h"
+#include "RenderStreamLinkInstrumentation.h"
+#include "RenderStreamTrace.h"
 
 #if defined WIN32 || defined WIN64
 #define WINDOWS
@@ -11,7 +14,9 @@
 
 #include "IDisplayCluster.h"
 #include "Interfaces/IPluginManager.h"
+#ifdef WINDOWS
 #include "Windows/MinWindows.h"
+#endif
 
 namespace {
     void log_default(const char* text) {
@@ -52,17 +57,26 @@ const char* RenderStreamLink::ParamTypeToName(RemoteParameterType type)
 
 RenderStreamLink::RenderStreamLink()
 {
-    loadExplicit();
+    if (!loadExplicit())
+        return;
+
+    const FString capturePath = RenderStreamTrace::GetRequestedCapture();
+    if (!capturePath.IsEmpty())
+        RenderStreamTrace::StartCapture(*this, capturePath);
+    if (RenderStreamLinkInstrumentation::IsRequested())
+        RenderStreamLinkInstrumentation::Install(*this);
 }
 
 RenderStreamLink::~RenderStreamLink()
 {
+    RenderStreamLinkInstrumentation::Uninstall(*this);
+    RenderStreamTrace::StopCapture(*this);
     unloadExplicit();
 }
 
 bool RenderStreamLink::isAvailable()
 {
-    return m_dll && m_loaded;
+    return (m_dll || m_inProcess) && m_loaded;
 }
 
 bool RenderStreamLink::loadExplicit()
@@ -70,6 +84,26 @@ bool RenderStreamLink::loadExplicit()
     if (isAvailable())
         return true;
 
+    const FString replayTrace = RenderStreamTrace::GetRequestedReplay();
+    const FString loopbackScenario = RenderStreamLoopback::GetRequestedScenario();
+    if (!replayTrace.IsEmpty() || !loopbackScenario.IsEmpty())
+    {
+        const bool bound = !replayTrace.IsEmpty() ? RenderStreamTrace::BindReplay(*this, replayTrace) : RenderStreamLoopback::Bind(*this, loopbackScenario);
+        if (!bound)
+        {
+            UE_LOG(LogRenderStream, Error, TEXT("Failed to start in-process RenderStream provider from %s."), !replayTrace.IsEmpty() ? *replayTrace : *loopbackScenario);
+            return false;
+        }
+
+        m_inProcess = true;
+        m_loaded = true;
+
+        rs_registerLoggingFunc(&log_default);
+        rs_registerErrorLoggingFunc(&log_error);
+        rs_registerVerboseLoggingFunc(&log_verbose);
+        return isAvailable();
+    }
+
 #ifdef WINDOWS
     
     auto GetD3PathFromReg = []() -> FString
@@ -203,11 +237,17 @@ bool RenderStreamLink::loadExplicit()
 
 bool RenderStreamLink::unloadExplicit()
 {
-    if (m_dll == nullptr || !m_loaded)
+    if ((m_dll == nullptr && !m_inProcess) || !m_loaded)
         return true;
 
     if (rs_shutdown)
         rs_shutdown();
+    if (m_inProcess)
+    {
+        RenderStreamTrace::UnbindReplay();
+        RenderStreamLoopback::Unbind();
+        m_inProcess = false;
+    }
 #ifdef WINDOWS
     if (m_dll)
         FreeLibrary((HMODULE)m_dll);
@@ -0,0 +1,351 @@
+#include "RenderStreamLinkInstrumentation.h"
+#include "RenderStream.h"
+#include "RenderStreamTelemetry.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTLS.h"
+#include "HAL/ThreadManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+
+#include <atomic>
+
+// Every instrumented entry point. The logging registration functions are left out, they are only called at load time.
+#define RS_INSTRUMENTED_FUNCTIONS(X) \
+    X(rs_initialise) \
+    X(rs_initialiseGpGpuWithDX11Device) \
+    X(rs_initialiseGpGpuWithDX12DeviceAndQueue) \
+    X(rs_initialiseGpGpuWithOpenGlContexts) \
+    X(rs_initialiseGpGpuWithVulkanDevice) \
+    X(rs_useDX12SharedHeapFlag) \
+    X(rs_setSchema) \
+    X(rs_saveSchema) \
+    X(rs_loadSchema) \
+    X(rs_shutdown) \
+    X(rs_getStreams) \
+    X(rs_awaitFrameData) \
+    X(rs_setFollower) \
+    X(rs_beginFollowerFrame) \
+    X(rs_getFrameParameters) \
+    X(rs_getFrameImageData) \
+    X(rs_getFrameImage2) \
+    X(rs_getFrameText) \
+    X(rs_getSkeletonLayout) \
+    X(rs_getSkeletonJointNames) \
+    X(rs_getSkeletonJointPoses) \
+    X(rs_getFrameCamera) \
+    X(rs_sendFrame2) \
+    X(rs_releaseImage2) \
+    X(rs_logToD3) \
+    X(rs_sendProfilingData) \
+    X(rs_setNewStatusMessage)
+
+namespace {
+    enum EFunction : uint32
+    {
+#define RS_ENUM(FUNC) E_##FUNC,
+        RS_INSTRUMENTED_FUNCTIONS(RS_ENUM)
+#undef RS_ENUM
+        E_Count
+    };
+
+    const TCHAR* const FunctionNames[] = {
+#define RS_NAME(FUNC) TEXT(#FUNC),
+        RS_INSTRUMENTED_FUNCTIONS(RS_NAME)
+#undef RS_NAME
+    };
+
+    // Names of the telemetry metrics, RegisterMetric copies them.
+    const TCHAR* const MetricNames[] = {
+#define RS_METRIC_NAME(FUNC) TEXT(#FUNC) TEXT(" max"),
+        RS_INSTRUMENTED_FUNCTIONS(RS_METRIC_NAME)
+#undef RS_METRIC_NAME
+    };
+    FRenderStreamMetric GMetrics[E_Count]; // registered on the first RecordTelemetry
+    bool GMetricsRegistered = false;
+
+    // Log-linear buckets over nanoseconds: four sub-buckets per power of two, which keeps percentiles within 25%
+    // from 1ns up to the full 64 bit range.
+    constexpr uint32 SubBucketBits = 2;
+    constexpr uint32 SubBuckets = 1u << SubBucketBits;
+    constexpr uint32 NumBuckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+    uint32 BucketIndex(uint64 Ns)
+    {
+        if (Ns < SubBuckets)
+            return uint32(Ns);
+        const uint32 Msb = FPlatformMath::FloorLog2_64(Ns);
+        const uint32 Shift = Msb - SubBucketBits;
+        return (Shift + 1) * SubBuckets + uint32(Ns >> Shift) - SubBuckets;
+    }
+
+    uint64 BucketUpperBound(uint32 Index)
+    {
+        if (Index < SubBuckets)
+            return Index;
+        const uint32 Shift = Index / SubBuckets - 1;
+        const uint64 Lower = uint64(Index % SubBuckets + SubBuckets) << Shift;
+        return Lower + (uint64(1) << Shift) - 1;
+    }
+
+    // Written only by the owning thread, read by whoever dumps or forwards the stats. WindowMaxNs is also reset by the
+    // game thread when it forwards the window.
+    struct FFunctionHistogram
+    {
+        std::atomic<uint64> Count{ 0 };
+        std::atomic<uint64> TotalNs{ 0 };
+        std::atomic<uint64> MaxNs{ 0 };
+        std::atomic<uint64> WindowMaxNs{ 0 };
+        std::atomic<uint64> Buckets[NumBuckets] = {};
+
+        void Record(uint64 Ns)
+        {
+            Count.store(Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            TotalNs.store(TotalNs.load(std::memory_order_relaxed) + Ns, std::memory_order_relaxed);
+            if (Ns > MaxNs.load(std::memory_order_relaxed))
+                MaxNs.store(Ns, std::memory_order_relaxed);
+            uint64 WindowMax = WindowMaxNs.load(std::memory_order_relaxed);
+            while (Ns > WindowMax && !WindowMaxNs.compare_exchange_weak(WindowMax, Ns, std::memory_order_relaxed))
+            {
+            }
+            std::atomic<uint64>& Bucket = Buckets[BucketIndex(Ns)];
+            Bucket.store(Bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        void Clear()
+        {
+            Count.store(0, std::memory_order_relaxed);
+            TotalNs.store(0, std::memory_order_relaxed);
+            MaxNs.store(0, std::memory_order_relaxed);
+            WindowMaxNs.store(0, std::memory_order_relaxed);
+            for (std::atomic<uint64>& Bucket : Buckets)
+                Bucket.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // One per calling thread, linked into a list that only ever grows. Kept for the lifetime of the process so a thread
+    // that has exited still shows up in the dump.
+    struct FThreadHistograms
+    {
+        uint32 ThreadId = 0;
+        FString ThreadName;
+        std::atomic<uint32> Generation{ 0 };
+        FThreadHistograms* Next = nullptr;
+        FFunctionHistogram Functions[E_Count];
+    };
+
+    std::atomic<FThreadHistograms*> GThreads{ nullptr };
+    std::atomic<uint32> GGeneration{ 0 }; // bumped by Reset, threads clear their own histograms when they see it change
+    std::atomic<bool> GInstalled{ false };
+    double GNanosecondsPerCycle = 0.0;
+    thread_local FThreadHistograms* GThisThread = nullptr;
+
+    FThreadHistograms& GetThreadHistograms()
+    {
+        if (!GThisThread)
+        {
+            FThreadHistograms* Histograms = new FThreadHistograms();
+            Histograms->ThreadId = FPlatformTLS::GetCurrentThreadId();
+            Histograms->ThreadName = FThreadManager::GetThreadName(Histograms->ThreadId);
+            if (Histograms->ThreadName.IsEmpty())
+                Histograms->ThreadName = IsInGameThread() ? TEXT("GameThread") : FString::Printf(TEXT("Thread %u"), Histograms->ThreadId);
+            Histograms->Generation.store(GGeneration.load());
+
+            FThreadHistograms* Head = GThreads.load();
+            do
+            {
+                Histograms->Next = Head;
+            } while (!GThreads.compare_exchange_weak(Head, Histograms));
+            GThisThread = Histograms;
+        }
+        return *GThisThread;
+    }
+
+    void Record(EFunction Function, uint64 Cycles)
+    {
+        FThreadHistograms& Histograms = GetThreadHistograms();
+        const uint32 Generation = GGeneration.load(std::memory_order_relaxed);
+        if (Histograms.Generation.load(std::memory_order_relaxed) != Generation)
+        {
+            for (FFunctionHistogram& Histogram : Histograms.Functions)
+                Histogram.Clear();
+            Histograms.Generation.store(Generation, std::memory_order_release);
+        }
+        Histograms.Functions[Function].Record(uint64(Cycles * GNanosecondsPerCycle));
+    }
+
+    bool IsCurrent(const FThreadHistograms& Histograms)
+    {
+        return Histograms.Generation.load(std::memory_order_acquire) == GGeneration.load(std::memory_order_relaxed);
+    }
+
+    template<EFunction Function, typename Fn>
+    struct TThunk;
+
+    template<EFunction Function, typename R, typename... Args>
+    struct TThunk<Function, R(*)(Args...)>
+    {
+        static inline R(*Original)(Args...) = nullptr;
+
+        static R Call(Args... Arguments)
+        {
+            struct FScopedTimer
+            {
+                const uint64 Start = FPlatformTime::Cycles64();
+                ~FScopedTimer() { Record(Function, FPlatformTime::Cycles64() - Start); }
+            } Timer;
+            return Original(Arguments...);
+        }
+    };
+
+    struct FSummary
+    {
+        uint64 Count = 0;
+        uint64 TotalNs = 0;
+        uint64 MaxNs = 0;
+        uint64 Buckets[NumBuckets] = {};
+
+        void Add(const FFunctionHistogram& Histogram)
+        {
+            Count += Histogram.Count.load(std::memory_order_relaxed);
+            TotalNs += Histogram.TotalNs.load(std::memory_order_relaxed);
+            MaxNs = FMath::Max(MaxNs, Histogram.MaxNs.load(std::memory_order_relaxed));
+            for (uint32 i = 0; i < NumBuckets; ++i)
+                Buckets[i] += Histogram.Buckets[i].load(std::memory_order_relaxed);
+        }
+
+        double PercentileUs(double Percentile) const
+        {
+            const uint64 Target = FMath::Max<uint64>(1, uint64(FMath::CeilToDouble(Count * Percentile)));
+            uint64 Seen = 0;
+            for (uint32 i = 0; i < NumBuckets; ++i)
+            {
+                Seen += Buckets[i];
+                if (Seen >= Target)
+                    return FMath::Min(BucketUpperBound(i), MaxNs) / 1000.0;
+            }
+            return MaxNs / 1000.0;
+        }
+    };
+
+    FString FormatSummary(const FSummary& Summary)
+    {
+        return FString::Printf(TEXT("calls %8llu  avg %9.1fus  p50 %9.1fus  p99 %9.1fus  max %9.1fus"),
+            Summary.Count, Summary.Count ? Summary.TotalNs / 1000.0 / Summary.Count : 0.0,
+            Summary.PercentileUs(0.5), Summary.PercentileUs(0.99), Summary.MaxNs / 1000.0);
+    }
+
+    FAutoConsoleCommandWithOutputDevice DumpCommand(
+        TEXT("RenderStream.LinkStats.Dump"),
+        TEXT("Prints call counts and latency percentiles of every rs_* function, per calling thread (requires -RenderStreamLinkStats)."),
+        FConsoleCommandWithOutputDeviceDelegate::CreateStatic(&RenderStreamLinkInstrumentation::Dump));
+
+    FAutoConsoleCommand ResetCommand(
+        TEXT("RenderStream.LinkStats.Reset"),
+        TEXT("Clears the rs_* latency histograms."),
+        FConsoleCommandDelegate::CreateStatic(&RenderStreamLinkInstrumentation::Reset));
+}
+
+bool RenderStreamLinkInstrumentation::IsRequested()
+{
+    return FParse::Param(FCommandLine::Get(), TEXT("RenderStreamLinkStats"));
+}
+
+void RenderStreamLinkInstrumentation::Install(RenderStreamLink& Link)
+{
+    if (GInstalled.exchange(true))
+        return;
+
+    GNanosecondsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1e9;
+
+#define RS_INSTALL(FUNC) \
+    if (Link.FUNC) \
+    { \
+        TThunk<E_##FUNC, decltype(Link.FUNC)>::Original = Link.FUNC; \
+        Link.FUNC = &TThunk<E_##FUNC, decltype(Link.FUNC)>::Call; \
+    }
+    RS_INSTRUMENTED_FUNCTIONS(RS_INSTALL)
+#undef RS_INSTALL
+
+    UE_LOG(LogRenderStream, Log, TEXT("RenderStream API latency instrumentation enabled."));
+}
+
+void RenderStreamLinkInstrumentation::Uninstall(RenderStreamLink& Link)
+{
+    if (!GInstalled.exchange(false))
+        return;
+
+#define RS_UNINSTALL(FUNC) \
+    if (Link.FUNC == &TThunk<E_##FUNC, decltype(Link.FUNC)>::Call) \
+        Link.FUNC = TThunk<E_##FUNC, decltype(Link.FUNC)>::Original;
+    RS_INSTRUMENTED_FUNCTIONS(RS_UNINSTALL)
+#undef RS_UNINSTALL
+}
+
+bool RenderStreamLinkInstrumentation::IsInstalled()
+{
+    return GInstalled.load();
+}
+
+void RenderStreamLinkInstrumentation::RecordTelemetry()
+{
+    if (!IsInstalled())
+        return;
+
+    if (!GMetricsRegistered)
+    {
+        for (uint32 i = 0; i < E_Count; ++i)
+            GMetrics[i] = FRenderStreamTelemetry::Get().RegisterMetric(MetricNames[i]);
+        GMetricsRegistered = true;
+    }
+
+    uint64 WindowMaxNs[E_Count] = {};
+    for (FThreadHistograms* Thread = GThreads.load(); Thread; Thread = Thread->Next)
+    {
+        if (!IsCurrent(*Thread))
+            continue;
+        for (uint32 i = 0; i < E_Count; ++i)
+            WindowMaxNs[i] = FMath::Max(WindowMaxNs[i], Thread->Functions[i].WindowMaxNs.exchange(0, std::memory_order_relaxed));
+    }
+
+    for (uint32 i = 0; i < E_Count; ++i)
+    {
+        if (WindowMaxNs[i] > 0)
+            FRenderStreamTelemetry::Get().Record(GMetrics[i], float(WindowMaxNs[i] / 1e6));
+    }
+}
+
+void RenderStreamLinkInstrumentation::Dump(FOutputDevice& Ar)
+{
+    if (!IsInstalled())
+    {
+        Ar.Logf(TEXT("RenderStream API instrumentation is not enabled, start with -RenderStreamLinkStats."));
+        return;
+    }
+
+    for (uint32 i = 0; i < E_Count; ++i)
+    {
+        FSummary Total;
+        TArray<TPair<const FThreadHistograms*, FSummary>> PerThread;
+        for (FThreadHistograms* Thread = GThreads.load(); Thread; Thread = Thread->Next)
+        {
+            if (!IsCurrent(*Thread) || Thread->Functions[i].Count.load(std::memory_order_relaxed) == 0)
+                continue;
+            FSummary& Summary = PerThread.Emplace_GetRef(Thread, FSummary()).Value;
+            Summary.Add(Thread->Functions[i]);
+            Total.Add(Thread->Functions[i]);
+        }
+
+        if (Total.Count == 0)
+            continue;
+
+        Ar.Logf(TEXT("%-42s %s"), FunctionNames[i], *FormatSummary(Total));
+        for (const TPair<const FThreadHistograms*, FSummary>& Thread : PerThread)
+            Ar.Logf(TEXT("    %-38s %s"), *FString::Printf(TEXT("%s (%u)"), *Thread.Key->ThreadName, Thread.Key->ThreadId), *FormatSummary(Thread.Value));
+    }
+}
+
+void RenderStreamLinkInstrumentation::Reset()
+{
+    GGeneration.fetch_add(1);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+
+// Opt-in latency instrumentation of the rs_* entry points.
+//
+// Started with -RenderStreamLinkStats, every function pointer in RenderStreamLink is replaced by a thunk that times the
+// call into a per-thread histogram. Recording never takes a lock: each calling thread owns its histograms and only
+// registers them once. Results can be printed with RenderStream.LinkStats.Dump, cleared with RenderStream.LinkStats.Reset,
+// and the worst latency of each call since the previous frame is recorded as an "rs_<function> max" telemetry metric.
+namespace RenderStreamLinkInstrumentation
+{
+    bool IsRequested();
+
+    void Install(RenderStreamLink& Link);
+    void Uninstall(RenderStreamLink& Link);
+    bool IsInstalled();
+
+    // Records the worst latency in milliseconds of every function called since the previous call. Game thread.
+    void RecordTelemetry();
+
+    void Dump(FOutputDevice& Ar);
+    void Reset();
+}
@@ -0,0 +1,236 @@
+#include "RenderStreamLogOutputDevice.h"
+
+#include "RenderStreamSettings.h"
+
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+    constexpr uint32 DrainIntervalMs = 10;
+
+    ELogVerbosity::Type ToLogVerbosity(ERenderStreamLogVerbosity Verbosity)
+    {
+        switch (Verbosity)
+        {
+        case ERenderStreamLogVerbosity::Fatal: return ELogVerbosity::Fatal;
+        case ERenderStreamLogVerbosity::Error: return ELogVerbosity::Error;
+        case ERenderStreamLogVerbosity::Warning: return ELogVerbosity::Warning;
+        case ERenderStreamLogVerbosity::Display: return ELogVerbosity::Display;
+        case ERenderStreamLogVerbosity::Log: return ELogVerbosity::Log;
+        case ERenderStreamLogVerbosity::Verbose: return ELogVerbosity::Verbose;
+        case ERenderStreamLogVerbosity::VeryVerbose: return ELogVerbosity::VeryVerbose;
+        }
+        return ELogVerbosity::Log;
+    }
+}
+
+FRenderStreamLogOutputDevice::FRenderStreamLogOutputDevice()
+{
+    check(GLog);
+
+    const URenderStreamSettings* settings = GetDefault<URenderStreamSettings>();
+    m_maxVerbosity = ToLogVerbosity(settings->LogForwardingVerbosity);
+    m_includeCategories = settings->LogForwardingIncludeCategories;
+    m_excludeCategories = settings->LogForwardingExcludeCategories;
+    m_maxLinesPerSecond = settings->LogForwardingMaxLinesPerSecond;
+
+    static_assert((RingSize & (RingSize - 1)) == 0, "RingSize must be a power of two");
+    m_ring = new FSlot[RingSize];
+    for (uint32 i = 0; i < RingSize; ++i)
+        m_ring[i].Sequence.store(i, std::memory_order_relaxed);
+
+    m_batch.Reserve(MaxBatchLength + 1);
+    m_rateWindowStart = FPlatformTime::Seconds();
+
+    m_wake = FPlatformProcess::GetSynchEventFromPool(false);
+    m_thread = FRunnableThread::Create(this, TEXT("RenderStreamLog"), 0, TPri_BelowNormal);
+
+    GLog->AddOutputDevice(this);
+}
+
+FRenderStreamLogOutputDevice::~FRenderStreamLogOutputDevice()
+{
+    if (GLog != nullptr)
+    {
+        GLog->RemoveOutputDevice(this);
+    }
+
+    // Deleting the thread stops it, the drain thread forwards whatever is left in the ring before it exits
+    delete m_thread;
+    m_thread = nullptr;
+
+    FPlatformProcess::ReturnSynchEventToPool(m_wake);
+    m_wake = nullptr;
+
+    delete[] m_ring;
+    m_ring = nullptr;
+}
+
+void FRenderStreamLogOutputDevice::Flush()
+{
+    FScopeLock Lock(&m_drainLock);
+    Drain(true);
+}
+
+void FRenderStreamLogOutputDevice::Serialize(const TCHAR* Message, ELogVerbosity::Type Verbosity, const class FName& Category)
+{
+    if (!Accepts(Verbosity, Category))
+        return;
+
+    if (!Enqueue(Message, Category))
+        m_droppedFull.fetch_add(1, std::memory_order_relaxed);
+
+    // The process is about to go down, forward everything now rather than waiting for the drain thread
+    if ((Verbosity & ELogVerbosity::VerbosityMask) == ELogVerbosity::Fatal)
+        Flush();
+}
+
+bool FRenderStreamLogOutputDevice::Accepts(ELogVerbosity::Type Verbosity, const FName& Category) const
+{
+    const ELogVerbosity::Type Level = ELogVerbosity::Type(Verbosity & ELogVerbosity::VerbosityMask);
+    if (Level == ELogVerbosity::NoLogging || Level > m_maxVerbosity)
+        return false;
+
+    if (m_includeCategories.Num() > 0 && !m_includeCategories.Contains(Category))
+        return false;
+
+    return !m_excludeCategories.Contains(Category);
+}
+
+bool FRenderStreamLogOutputDevice::Enqueue(const TCHAR* Message, const FName& Category)
+{
+    FSlot* Slot = nullptr;
+    uint32 Pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Slot = &m_ring[Pos & (RingSize - 1)];
+        const uint32 Sequence = Slot->Sequence.load(std::memory_order_acquire);
+        const int32 Diff = int32(Sequence - Pos);
+        if (Diff == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (Diff < 0)
+        {
+            return false; // full, the drain thread has not caught up with this slot yet
+        }
+        else
+        {
+            Pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Non-ASCII characters are replaced, like TCHAR_TO_ANSI does for characters outside the code page
+    int32 Length = 0;
+    for (const TCHAR* c = Message; *c && Length < MaxLineLength; ++c)
+        Slot->Text[Length++] = uint32(*c) < 0x80 ? char(*c) : '?';
+    Slot->Length = Length;
+    Slot->Category = Category;
+
+    Slot->Sequence.store(Pos + 1, std::memory_order_release);
+    return true;
+}
+
+uint32 FRenderStreamLogOutputDevice::Run()
+{
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        m_wake->Wait(DrainIntervalMs);
+
+        FScopeLock Lock(&m_drainLock);
+        Drain(false);
+    }
+
+    FScopeLock Lock(&m_drainLock);
+    Drain(true);
+    return 0;
+}
+
+void FRenderStreamLogOutputDevice::Stop()
+{
+    m_stop.store(true, std::memory_order_relaxed);
+    m_wake->Trigger();
+}
+
+void FRenderStreamLogOutputDevice::Drain(bool bIgnoreRateLimit)
+{
+    const double Now = FPlatformTime::Seconds();
+    const bool bNewWindow = Now - m_rateWindowStart >= 1.0;
+    if (bNewWindow)
+    {
+        m_rateWindowStart = Now;
+        m_rateWindowLines = 0;
+    }
+
+    for (;;)
+    {
+        FSlot& Slot = m_ring[m_dequeuePos & (RingSize - 1)];
+        if (Slot.Sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+            break;
+
+        if (bIgnoreRateLimit || m_maxLinesPerSecond <= 0 || m_rateWindowLines < m_maxLinesPerSecond)
+        {
+            TCHAR CategoryName[NAME_SIZE];
+            const uint32 CategoryLength = Slot.Category.ToString(CategoryName);
+
+            char Line[NAME_SIZE + 2 + MaxLineLength];
+            int32 Length = 0;
+            for (uint32 i = 0; i < CategoryLength; ++i)
+                Line[Length++] = uint32(CategoryName[i]) < 0x80 ? char(CategoryName[i]) : '?';
+            Line[Length++] = ':';
+            Line[Length++] = ' ';
+            FMemory::Memcpy(Line + Length, Slot.Text, Slot.Length);
+            Length += Slot.Length;
+
+            AppendToBatch(Line, Length);
+            ++m_rateWindowLines;
+        }
+        else
+        {
+            ++m_droppedRate;
+        }
+
+        Slot.Sequence.store(m_dequeuePos + RingSize, std::memory_order_release);
+        ++m_dequeuePos;
+    }
+
+    // Report drops at most once per rate window so the report itself does not flood d3
+    if (bNewWindow || bIgnoreRateLimit)
+    {
+        const uint32 Dropped = m_droppedFull.exchange(0, std::memory_order_relaxed) + m_droppedRate;
+        m_droppedRate = 0;
+        if (Dropped > 0)
+        {
+            char Line[64];
+            const int32 Length = FCStringAnsi::Snprintf(Line, sizeof(Line), "LogRenderStream: %u log lines dropped", Dropped);
+            AppendToBatch(Line, FMath::Min<int32>(Length, sizeof(Line) - 1));
+        }
+    }
+
+    SendBatch();
+}
+
+void FRenderStreamLogOutputDevice::AppendToBatch(const char* Text, int32 Length)
+{
+    if (m_batch.Num() > 0 && m_batch.Num() + 1 + Length > MaxBatchLength)
+        SendBatch();
+
+    if (m_batch.Num() > 0)
+        m_batch.Add('\n');
+    m_batch.Append(Text, Length);
+}
+
+void FRenderStreamLogOutputDevice::SendBatch()
+{
+    if (m_batch.Num() == 0)
+        return;
+
+    m_batch.Add('\0');
+    if (RenderStreamLink::instance().isAvailable())
+        RenderStreamLink::instance().rs_logToD3(m_batch.GetData());
+    m_batch.Reset();
+}
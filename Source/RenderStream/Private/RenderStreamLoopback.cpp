@@ -0,0 +1,987 @@
+#include "RenderStreamLoopback.h"
+#include "RenderStream.h"
+
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "Hash/CityHash.h"
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Link = RenderStreamLink;
+
+    struct FLoopbackStream
+    {
+        std::string Name;
+        std::string Channel;
+        std::string MappingName;
+        Link::StreamHandle Handle = 0;
+        uint64_t MappingId = 0;
+        int32_t Viewpoint = 0;
+        int32_t Fragment = 0;
+        uint32_t Width = 1920;
+        uint32_t Height = 1080;
+        Link::RSPixelFormat Format = Link::RS_FMT_BGRA8;
+        Link::ProjectionClipping Clipping = { 0.f, 1.f, 0.f, 1.f };
+        uint32_t RequestEvery = 1; // Camera data is only available every N frames, to mimic streams requested at a lower rate.
+        uint32_t AltWidth = 0;     // size a streams change swaps in, see ChangeStreams
+        uint32_t AltHeight = 0;
+    };
+
+    struct FLoopbackParameter
+    {
+        std::string Group;
+        std::string DisplayName;
+        std::string Key;
+        std::string TextDefault;
+        Link::RemoteParameterType Type = Link::RS_PARAMETER_NUMBER;
+        Link::NumericalDefaults Number = { 0.f, 1.f, 0.001f, 0.f };
+        std::vector<std::string> Options;
+        uint32_t Flags = Link::REMOTEPARAMETER_NO_FLAGS;
+    };
+
+    struct FLoopbackScene
+    {
+        std::string Name;
+        std::vector<FLoopbackParameter> Parameters;
+        uint64_t Hash = 0;
+    };
+
+    struct FLoopbackScenario
+    {
+        uint32_t RateNumerator = 60;
+        uint32_t RateDenominator = 1;
+        uint32_t StreamsChangedEvery = 0; // frames, 0 = only once at startup. Each change resizes one stream.
+        uint32_t TimeoutEvery = 0;        // frames, 0 = never simulate a missed request
+        uint32_t QuitAfterFrames = 0;     // frames, 0 = never
+
+        std::vector<FLoopbackStream> Streams;
+
+        bool HasSchema = false;
+        std::vector<std::string> Channels;
+        std::vector<FLoopbackScene> Scenes;
+
+        std::vector<std::string> Texts = { "RenderStream loopback" };
+
+        Link::CameraHandle CameraHandle = 1; // 0 = 2D mapping
+        float CameraRadius = 5.f;
+        float CameraHeight = 1.7f;
+        float CameraPeriod = 10.f;
+        float FocalLength = 30.f;
+        float SensorX = 36.f;
+        float SensorY = 24.f;
+        float NearZ = 0.1f;
+        float FarZ = 1000.f;
+        float OrthoWidth = 0.f;
+
+        uint32_t SkeletonJoints = 18;
+        uint32_t ImageWidth = 256;
+        uint32_t ImageHeight = 256;
+        Link::RSPixelFormat ImageFormat = Link::RS_FMT_RGBA8;
+    };
+
+    struct FLoopbackState
+    {
+        FLoopbackScenario Scenario;
+        std::vector<FLoopbackScene> ActiveScenes; // schema served by rs_loadSchema or set by rs_setSchema
+        std::vector<FLoopbackScene> SavedScenes;  // schema stored by rs_saveSchema
+        std::vector<std::string> SavedChannels;
+        bool HasSavedSchema = false;
+
+        // Frame state is only touched by the thread driving the frame loop (rs_awaitFrameData / rs_beginFollowerFrame and the getters).
+        uint64_t FrameIndex = 0;
+        double NextFrameTime = 0.0;
+        bool StreamsPending = true;
+        uint64_t StreamChanges = 0;
+        bool Quit = false;
+
+        std::atomic<uint64_t> FramesSent{ 0 };
+    };
+
+    TUniquePtr<FLoopbackState> GLoopback;
+
+    const char* const JointNames[] = {
+        "Pelvis", "Spine", "Chest", "Neck",
+        "LeftClavicle", "LeftShoulder", "LeftElbow", "LeftWrist", "LeftHip", "LeftKnee", "LeftAnkle",
+        "RightClavicle", "RightShoulder", "RightElbow", "RightWrist", "RightHip", "RightKnee", "RightAnkle",
+    };
+
+    Link::RSPixelFormat ParseFormat(const FString& Name, Link::RSPixelFormat Default)
+    {
+        static const TCHAR* Names[] = { TEXT("INVALID"), TEXT("BGRA8"), TEXT("BGRX8"), TEXT("RGBA32F"), TEXT("RGBA16"), TEXT("RGBA8"), TEXT("RGBX8") };
+        for (uint32_t i = 0; i < UE_ARRAY_COUNT(Names); ++i)
+        {
+            if (Name.Equals(Names[i], ESearchCase::IgnoreCase))
+                return static_cast<Link::RSPixelFormat>(i);
+        }
+        return Default;
+    }
+
+    bool ParseParameterType(const FString& Name, Link::RemoteParameterType& OutType)
+    {
+        for (int i = 0; i <= Link::RS_PARAMETER_LAST; ++i)
+        {
+            const Link::RemoteParameterType Type = static_cast<Link::RemoteParameterType>(i);
+            if (Name.Equals(UTF8_TO_TCHAR(Link::ParamTypeToName(Type)), ESearchCase::IgnoreCase))
+            {
+                OutType = Type;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string ToStd(const FString& Str)
+    {
+        return std::string(TCHAR_TO_UTF8(*Str));
+    }
+
+    uint64_t HashScene(const FLoopbackScene& Scene)
+    {
+        std::string Key = Scene.Name;
+        for (const FLoopbackParameter& Parameter : Scene.Parameters)
+        {
+            Key += '\n';
+            Key += Parameter.Key;
+            Key += char('0' + Parameter.Type);
+        }
+        return CityHash64(Key.data(), Key.size());
+    }
+
+    void ParseStreams(const TSharedPtr<FJsonObject>& Json, FLoopbackScenario& Scenario)
+    {
+        const TSharedPtr<FJsonObject>* StreamsObject = nullptr;
+        if (!Json->TryGetObjectField(TEXT("streams"), StreamsObject))
+        {
+            Scenario.Streams.resize(1);
+        }
+        else
+        {
+            const TSharedPtr<FJsonObject>& S = *StreamsObject;
+            const uint32_t Count = uint32_t(FMath::Max(0, int32(S->GetIntegerField(TEXT("count")))));
+            // Fragments split a viewpoint into horizontal tiles, duplicates request identical streams under new handles.
+            const uint32_t Fragments = FMath::Max(1u, uint32_t(S->HasField(TEXT("fragments")) ? S->GetIntegerField(TEXT("fragments")) : 1));
+            const uint32_t Duplicates = FMath::Max(1u, uint32_t(S->HasField(TEXT("duplicates")) ? S->GetIntegerField(TEXT("duplicates")) : 1));
+            const FString Prefix = S->HasField(TEXT("name")) ? S->GetStringField(TEXT("name")) : FString(TEXT("Loopback"));
+
+            FLoopbackStream Template;
+            if (S->HasField(TEXT("width")))
+                Template.Width = uint32_t(S->GetIntegerField(TEXT("width")));
+            if (S->HasField(TEXT("height")))
+                Template.Height = uint32_t(S->GetIntegerField(TEXT("height")));
+            if (S->HasField(TEXT("format")))
+                Template.Format = ParseFormat(S->GetStringField(TEXT("format")), Template.Format);
+            if (S->HasField(TEXT("channel")))
+                Template.Channel = ToStd(S->GetStringField(TEXT("channel")));
+            if (S->HasField(TEXT("requestEvery")))
+                Template.RequestEvery = FMath::Max(1u, uint32_t(S->GetIntegerField(TEXT("requestEvery"))));
+
+            for (uint32_t iViewpoint = 0; iViewpoint < Count; ++iViewpoint)
+            {
+                for (uint32_t iFragment = 0; iFragment < Fragments; ++iFragment)
+                {
+                    for (uint32_t iDuplicate = 0; iDuplicate < Duplicates; ++iDuplicate)
+                    {
+                        FLoopbackStream Stream = Template;
+                        Stream.Name = ToStd(FString::Printf(TEXT("%s_%u_%u_%u"), *Prefix, iViewpoint, iFragment, iDuplicate));
+                        Stream.MappingName = ToStd(FString::Printf(TEXT("%s mapping"), *Prefix));
+                        Stream.MappingId = 1;
+                        Stream.Viewpoint = int32_t(iViewpoint);
+                        Stream.Fragment = int32_t(iFragment);
+                        Stream.Width = FMath::Max(1u, Template.Width / Fragments);
+                        Stream.Clipping.left = float(iFragment) / Fragments;
+                        Stream.Clipping.right = float(iFragment + 1) / Fragments;
+                        Scenario.Streams.push_back(Stream);
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < Scenario.Streams.size(); ++i)
+            Scenario.Streams[i].Handle = Link::StreamHandle(0x1000 + i);
+    }
+
+    bool ParseSchema(const TSharedPtr<FJsonObject>& Json, FLoopbackScenario& Scenario)
+    {
+        const TSharedPtr<FJsonObject>* SchemaObject = nullptr;
+        if (!Json->TryGetObjectField(TEXT("schema"), SchemaObject))
+            return true;
+
+        const TArray<TSharedPtr<FJsonValue>>* Channels = nullptr;
+        if ((*SchemaObject)->TryGetArrayField(TEXT("channels"), Channels))
+        {
+            for (const TSharedPtr<FJsonValue>& Channel : *Channels)
+                Scenario.Channels.push_back(ToStd(Channel->AsString()));
+        }
+
+        const TArray<TSharedPtr<FJsonValue>>* Scenes = nullptr;
+        if (!(*SchemaObject)->TryGetArrayField(TEXT("scenes"), Scenes))
+            return true;
+
+        for (const TSharedPtr<FJsonValue>& SceneValue : *Scenes)
+        {
+            const TSharedPtr<FJsonObject> SceneObject = SceneValue->AsObject();
+            if (!SceneObject)
+                continue;
+
+            FLoopbackScene Scene;
+            Scene.Name = ToStd(SceneObject->GetStringField(TEXT("name")));
+
+            const TArray<TSharedPtr<FJsonValue>>* Parameters = nullptr;
+            if (SceneObject->TryGetArrayField(TEXT("parameters"), Parameters))
+            {
+                for (const TSharedPtr<FJsonValue>& ParameterValue : *Parameters)
+                {
+                    const TSharedPtr<FJsonObject> P = ParameterValue->AsObject();
+                    if (!P)
+                        continue;
+
+                    FLoopbackParameter Parameter;
+                    Parameter.Key = ToStd(P->GetStringField(TEXT("key")));
+                    Parameter.DisplayName = P->HasField(TEXT("displayName")) ? ToStd(P->GetStringField(TEXT("displayName"))) : Parameter.Key;
+                    Parameter.Group = P->HasField(TEXT("group")) ? ToStd(P->GetStringField(TEXT("group"))) : std::string("Loopback");
+                    if (!ParseParameterType(P->GetStringField(TEXT("type")), Parameter.Type))
+                    {
+                        UE_LOG(LogRenderStream, Error, TEXT("Loopback: unknown type '%s' for parameter '%s'"), *P->GetStringField(TEXT("type")), UTF8_TO_TCHAR(Parameter.Key.c_str()));
+                        return false;
+                    }
+                    if (P->HasField(TEXT("min")))
+                        Parameter.Number.min = float(P->GetNumberField(TEXT("min")));
+                    if (P->HasField(TEXT("max")))
+                        Parameter.Number.max = float(P->GetNumberField(TEXT("max")));
+                    if (P->HasField(TEXT("default")))
+                    {
+                        if (Parameter.Type == Link::RS_PARAMETER_TEXT)
+                            Parameter.TextDefault = ToStd(P->GetStringField(TEXT("default")));
+                        else
+                            Parameter.Number.defaultValue = float(P->GetNumberField(TEXT("default")));
+                    }
+                    Scene.Parameters.push_back(Parameter);
+                }
+            }
+
+            Scene.Hash = HashScene(Scene);
+            Scenario.Scenes.push_back(Scene);
+        }
+
+        Scenario.HasSchema = true;
+        return true;
+    }
+
+    bool LoadScenario(const FString& Path, FLoopbackScenario& Scenario)
+    {
+        FString Text;
+        if (!FFileHelper::LoadFileToString(Text, *Path))
+        {
+            UE_LOG(LogRenderStream, Error, TEXT("Loopback: failed to read scenario '%s'"), *Path);
+            return false;
+        }
+
+        TSharedPtr<FJsonObject> Json;
+        const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Text);
+        if (!FJsonSerializer::Deserialize(Reader, Json) || !Json.IsValid())
+        {
+            UE_LOG(LogRenderStream, Error, TEXT("Loopback: failed to parse scenario '%s'"), *Path);
+            return false;
+        }
+
+        const TSharedPtr<FJsonObject>* Rate = nullptr;
+        if (Json->TryGetObjectField(TEXT("frameRate"), Rate))
+        {
+            Scenario.RateNumerator = uint32_t(FMath::Max(1, int32((*Rate)->GetIntegerField(TEXT("numerator")))));
+            Scenario.RateDenominator = uint32_t(FMath::Max(1, int32((*Rate)->GetIntegerField(TEXT("denominator")))));
+        }
+        Json->TryGetNumberField(TEXT("streamsChangedEvery"), Scenario.StreamsChangedEvery);
+        Json->TryGetNumberField(TEXT("timeoutEvery"), Scenario.TimeoutEvery);
+        Json->TryGetNumberField(TEXT("quitAfterFrames"), Scenario.QuitAfterFrames);
+
+        const TSharedPtr<FJsonObject>* Camera = nullptr;
+        if (Json->TryGetObjectField(TEXT("camera"), Camera))
+        {
+            const TSharedPtr<FJsonObject>& C = *Camera;
+            double Handle = double(Scenario.CameraHandle);
+            C->TryGetNumberField(TEXT("handle"), Handle);
+            Scenario.CameraHandle = Link::CameraHandle(Handle);
+            C->TryGetNumberField(TEXT("radius"), Scenario.CameraRadius);
+            C->TryGetNumberField(TEXT("height"), Scenario.CameraHeight);
+            C->TryGetNumberField(TEXT("period"), Scenario.CameraPeriod);
+            C->TryGetNumberField(TEXT("focalLength"), Scenario.FocalLength);
+            C->TryGetNumberField(TEXT("sensorX"), Scenario.SensorX);
+            C->TryGetNumberField(TEXT("sensorY"), Scenario.SensorY);
+            C->TryGetNumberField(TEXT("nearZ"), Scenario.NearZ);
+            C->TryGetNumberField(TEXT("farZ"), Scenario.FarZ);
+            C->TryGetNumberField(TEXT("orthoWidth"), Scenario.OrthoWidth);
+        }
+
+        const TArray<TSharedPtr<FJsonValue>>* Texts = nullptr;
+        if (Json->TryGetArrayField(TEXT("text"), Texts) && Texts->Num() > 0)
+        {
+            Scenario.Texts.clear();
+            for (const TSharedPtr<FJsonValue>& Value : *Texts)
+                Scenario.Texts.push_back(ToStd(Value->AsString()));
+        }
+
+        Json->TryGetNumberField(TEXT("skeletonJoints"), Scenario.SkeletonJoints);
+        Scenario.SkeletonJoints = FMath::Clamp<uint32_t>(Scenario.SkeletonJoints, 1, UE_ARRAY_COUNT(JointNames));
+
+        const TSharedPtr<FJsonObject>* Image = nullptr;
+        if (Json->TryGetObjectField(TEXT("image"), Image))
+        {
+            (*Image)->TryGetNumberField(TEXT("width"), Scenario.ImageWidth);
+            (*Image)->TryGetNumberField(TEXT("height"), Scenario.ImageHeight);
+            if ((*Image)->HasField(TEXT("format")))
+                Scenario.ImageFormat = ParseFormat((*Image)->GetStringField(TEXT("format")), Scenario.ImageFormat);
+        }
+
+        // Environment overrides so the same scenario can be swept over rates and stream counts.
+        const FString RateOverride = FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_LOOPBACK_RATE"));
+        if (!RateOverride.IsEmpty() && FCString::Atoi(*RateOverride) > 0)
+        {
+            Scenario.RateNumerator = uint32_t(FCString::Atoi(*RateOverride));
+            Scenario.RateDenominator = 1;
+        }
+        const FString StreamsOverride = FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_LOOPBACK_STREAMS"));
+        if (!StreamsOverride.IsEmpty())
+        {
+            TSharedPtr<FJsonObject> Streams = MakeShared<FJsonObject>();
+            const TSharedPtr<FJsonObject>* Existing = nullptr;
+            if (Json->TryGetObjectField(TEXT("streams"), Existing))
+                Streams = *Existing;
+            Streams->SetNumberField(TEXT("count"), FCString::Atoi(*StreamsOverride));
+            Json->SetObjectField(TEXT("streams"), Streams);
+        }
+
+        ParseStreams(Json, Scenario);
+        return ParseSchema(Json, Scenario);
+    }
+
+    // Lays out API structures in a caller supplied buffer, the same way the DLL does.
+    // With a null buffer it only measures, so callers build values locally and store them if the pointer is valid.
+    class FPacker
+    {
+    public:
+        explicit FPacker(uint8* InBase) : Base(InBase) {}
+
+        template<typename T>
+        T* Alloc(size_t Count = 1)
+        {
+            Used = Align(Used, alignof(T));
+            T* Result = Base ? reinterpret_cast<T*>(Base + Used) : nullptr;
+            Used += sizeof(T) * Count;
+            return Result;
+        }
+
+        const char* String(const std::string& Str)
+        {
+            char* Out = Alloc<char>(Str.size() + 1);
+            if (Out)
+                memcpy(Out, Str.c_str(), Str.size() + 1);
+            return Out;
+        }
+
+        size_t Size() const { return Used; }
+
+    private:
+        uint8* Base;
+        size_t Used = 0;
+    };
+
+    void PackStreams(FPacker& Packer, const std::vector<FLoopbackStream>& Streams)
+    {
+        Link::StreamDescriptions* Header = Packer.Alloc<Link::StreamDescriptions>();
+        Link::StreamDescription* Descriptions = Packer.Alloc<Link::StreamDescription>(Streams.size());
+        for (size_t i = 0; i < Streams.size(); ++i)
+        {
+            const FLoopbackStream& Stream = Streams[i];
+            Link::StreamDescription Description = {};
+            Description.handle = Stream.Handle;
+            Description.channel = Packer.String(Stream.Channel);
+            Description.mappingId = Stream.MappingId;
+            Description.iViewpoint = Stream.Viewpoint;
+            Description.name = Packer.String(Stream.Name);
+            Description.width = Stream.Width;
+            Description.height = Stream.Height;
+            Description.format = Stream.Format;
+            Description.clipping = Stream.Clipping;
+            Description.mappingName = Packer.String(Stream.MappingName);
+            Description.iFragment = Stream.Fragment;
+            if (Descriptions)
+                Descriptions[i] = Description;
+        }
+        if (Header)
+            *Header = { uint32_t(Streams.size()), Descriptions };
+    }
+
+    void PackSchema(FPacker& Packer, const std::vector<std::string>& Channels, const std::vector<FLoopbackScene>& Scenes)
+    {
+        Link::Schema* Header = Packer.Alloc<Link::Schema>();
+        Link::Schema Schema = {};
+        Schema.engineName = Packer.String(EPIC_PRODUCT_NAME);
+        Schema.engineVersion = Packer.String(TCHAR_TO_UTF8(ENGINE_VERSION_STRING));
+        Schema.pluginVersion = Packer.String(RS_PLUGIN_VERSION);
+        Schema.info = Packer.String("RenderStream loopback");
+
+        Schema.channels.nChannels = uint32_t(Channels.size());
+        Schema.channels.channels = Packer.Alloc<const char*>(Channels.size());
+        for (size_t i = 0; i < Channels.size(); ++i)
+        {
+            const char* Channel = Packer.String(Channels[i]);
+            if (Schema.channels.channels)
+                Schema.channels.channels[i] = Channel;
+        }
+
+        Schema.scenes.nScenes = uint32_t(Scenes.size());
+        Schema.scenes.scenes = Packer.Alloc<Link::RemoteParameters>(Scenes.size());
+        for (size_t i = 0; i < Scenes.size(); ++i)
+        {
+            const FLoopbackScene& Scene = Scenes[i];
+            Link::RemoteParameters Parameters = {};
+            Parameters.name = Packer.String(Scene.Name);
+            Parameters.hash = Scene.Hash;
+            Parameters.nParameters = uint32_t(Scene.Parameters.size());
+            Parameters.parameters = Packer.Alloc<Link::RemoteParameter>(Scene.Parameters.size());
+            for (size_t j = 0; j < Scene.Parameters.size(); ++j)
+            {
+                const FLoopbackParameter& Source = Scene.Parameters[j];
+                Link::RemoteParameter Parameter = {};
+                Parameter.group = Packer.String(Source.Group);
+                Parameter.displayName = Packer.String(Source.DisplayName);
+                Parameter.key = Packer.String(Source.Key);
+                Parameter.type = Source.Type;
+                if (Source.Type == Link::RS_PARAMETER_TEXT)
+                    Parameter.defaults.text.defaultValue = Packer.String(Source.TextDefault);
+                else
+                    Parameter.defaults.number = Source.Number;
+                Parameter.nOptions = uint32_t(Source.Options.size());
+                Parameter.options = Packer.Alloc<const char*>(Source.Options.size());
+                for (size_t k = 0; k < Source.Options.size(); ++k)
+                {
+                    const char* Option = Packer.String(Source.Options[k]);
+                    if (Parameter.options)
+                        Parameter.options[k] = Option;
+                }
+                Parameter.dmxOffset = -1;
+                Parameter.dmxType = Link::RS_DMX_16_BE;
+                Parameter.flags = Source.Flags;
+                if (Parameters.parameters)
+                    Parameters.parameters[j] = Parameter;
+            }
+            if (Schema.scenes.scenes)
+                Schema.scenes.scenes[i] = Parameters;
+        }
+
+        if (Header)
+            *Header = Schema;
+    }
+
+    template<typename PackFn>
+    Link::RS_ERROR PackInto(void* Out, uint32_t* InOutBytes, PackFn&& Pack)
+    {
+        if (!InOutBytes)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FPacker Measure(nullptr);
+        Pack(Measure);
+        if (!Out || *InOutBytes < Measure.Size())
+        {
+            *InOutBytes = uint32_t(Measure.Size());
+            return Link::RS_ERROR_BUFFER_OVERFLOW;
+        }
+
+        FPacker Writer(static_cast<uint8*>(Out));
+        Pack(Writer);
+        *InOutBytes = uint32_t(Writer.Size());
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    std::vector<FLoopbackScene> CopyScenes(const Link::Schema& Schema)
+    {
+        std::vector<FLoopbackScene> Scenes;
+        for (uint32_t i = 0; i < Schema.scenes.nScenes; ++i)
+        {
+            const Link::RemoteParameters& Source = Schema.scenes.scenes[i];
+            FLoopbackScene Scene;
+            Scene.Name = Source.name ? Source.name : "";
+            for (uint32_t j = 0; j < Source.nParameters; ++j)
+            {
+                const Link::RemoteParameter& P = Source.parameters[j];
+                FLoopbackParameter Parameter;
+                Parameter.Group = P.group ? P.group : "";
+                Parameter.DisplayName = P.displayName ? P.displayName : "";
+                Parameter.Key = P.key ? P.key : "";
+                Parameter.Type = P.type;
+                if (P.type == Link::RS_PARAMETER_TEXT)
+                    Parameter.TextDefault = P.defaults.text.defaultValue ? P.defaults.text.defaultValue : "";
+                else
+                    Parameter.Number = P.defaults.number;
+                for (uint32_t k = 0; k < P.nOptions; ++k)
+                    Parameter.Options.push_back(P.options[k]);
+                Parameter.Flags = P.flags;
+                Scene.Parameters.push_back(Parameter);
+            }
+            Scene.Hash = HashScene(Scene);
+            Scenes.push_back(Scene);
+        }
+        return Scenes;
+    }
+
+    const FLoopbackScene* FindScene(uint64_t Hash)
+    {
+        for (const FLoopbackScene& Scene : GLoopback->ActiveScenes)
+        {
+            if (Scene.Hash == Hash)
+                return &Scene;
+        }
+        return nullptr;
+    }
+
+    const FLoopbackStream* FindStream(Link::StreamHandle Handle)
+    {
+        for (const FLoopbackStream& Stream : GLoopback->Scenario.Streams)
+        {
+            if (Stream.Handle == Handle)
+                return &Stream;
+        }
+        return nullptr;
+    }
+
+    // Toggles one stream between its scenario size and half of it, a different stream each time, the way d3 resizing one
+    // output leaves the others untouched. Handles and the stream list stay the same, the RHI thread may be sending.
+    void ChangeStreams(FLoopbackState& State)
+    {
+        std::vector<FLoopbackStream>& Streams = State.Scenario.Streams;
+        if (Streams.empty())
+            return;
+
+        FLoopbackStream& Stream = Streams[State.StreamChanges++ % Streams.size()];
+        if (Stream.AltWidth == 0)
+        {
+            Stream.AltWidth = FMath::Max(1u, Stream.Width / 2);
+            Stream.AltHeight = FMath::Max(1u, Stream.Height / 2);
+        }
+        std::swap(Stream.Width, Stream.AltWidth);
+        std::swap(Stream.Height, Stream.AltHeight);
+    }
+
+    double FrameTime(uint64_t Frame)
+    {
+        const FLoopbackScenario& Scenario = GLoopback->Scenario;
+        return double(Frame) * Scenario.RateDenominator / Scenario.RateNumerator;
+    }
+
+    float Wave(double Time, size_t Index)
+    {
+        return float(0.5 + 0.5 * FMath::Sin(Time + double(Index) * 0.37));
+    }
+
+    Link::Transform AnimatedTransform(double Time, size_t Index)
+    {
+        const FQuat4f Rotation(FVector3f(0.f, 1.f, 0.f), float(0.25 * FMath::Sin(Time + Index)));
+        return { 0.f, 0.05f * Wave(Time, Index), 0.1f, Rotation.X, Rotation.Y, Rotation.Z, Rotation.W };
+    }
+
+    // rs_* implementations
+
+    void Loopback_registerLogging(Link::logger_t) {}
+    void Loopback_unregisterLogging() {}
+
+    Link::RS_ERROR Loopback_initialise(int expectedVersionMajor, int expectedVersionMinor)
+    {
+        if (expectedVersionMajor != RENDER_STREAM_VERSION_MAJOR)
+            return Link::RS_ERROR_INCOMPATIBLE_VERSION;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_initialiseGpGpuWithDX11Device(ID3D11Device*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_initialiseGpGpuWithDX12DeviceAndQueue(ID3D12Device*, ID3D12CommandQueue*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_initialiseGpGpuWithOpenGlContexts(HGLRC, HDC) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_initialiseGpGpuWithVulkanDevice(VkDevice) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_shutdown() { return Link::RS_ERROR_SUCCESS; }
+
+    Link::RS_ERROR Loopback_useDX12SharedHeapFlag(Link::UseDX12SharedHeapFlag* flag)
+    {
+        if (!flag)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        *flag = Link::RS_DX12_USE_SHARED_HEAP_FLAG;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_saveSchema(const char*, Link::Schema* schema)
+    {
+        if (!schema)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        GLoopback->SavedScenes = CopyScenes(*schema);
+        GLoopback->SavedChannels.clear();
+        for (uint32_t i = 0; i < schema->channels.nChannels; ++i)
+            GLoopback->SavedChannels.push_back(schema->channels.channels[i]);
+        GLoopback->HasSavedSchema = true;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_loadSchema(const char*, Link::Schema* schema, uint32_t* nBytes)
+    {
+        const FLoopbackScenario& Scenario = GLoopback->Scenario;
+        const bool FromScenario = Scenario.HasSchema;
+        if (!FromScenario && !GLoopback->HasSavedSchema)
+            return Link::RS_ERROR_NOTFOUND;
+
+        const std::vector<std::string>& Channels = FromScenario ? Scenario.Channels : GLoopback->SavedChannels;
+        const std::vector<FLoopbackScene>& Scenes = FromScenario ? Scenario.Scenes : GLoopback->SavedScenes;
+        const Link::RS_ERROR Result = PackInto(schema, nBytes, [&](FPacker& Packer) { PackSchema(Packer, Channels, Scenes); });
+        if (Result == Link::RS_ERROR_SUCCESS)
+            GLoopback->ActiveScenes = Scenes;
+        return Result;
+    }
+
+    Link::RS_ERROR Loopback_setSchema(Link::Schema* schema)
+    {
+        if (!schema)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        GLoopback->ActiveScenes = CopyScenes(*schema);
+        for (uint32_t i = 0; i < schema->scenes.nScenes; ++i)
+            schema->scenes.scenes[i].hash = GLoopback->ActiveScenes[i].Hash;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getStreams(Link::StreamDescriptions* streams, uint32_t* nBytes)
+    {
+        return PackInto(streams, nBytes, [](FPacker& Packer) { PackStreams(Packer, GLoopback->Scenario.Streams); });
+    }
+
+    Link::RS_ERROR Loopback_awaitFrameData(int timeoutMs, Link::FrameData* data)
+    {
+        FLoopbackState& State = *GLoopback;
+        const FLoopbackScenario& Scenario = State.Scenario;
+        if (State.Quit)
+            return Link::RS_ERROR_QUIT;
+
+        if (State.StreamsPending)
+        {
+            State.StreamsPending = false;
+            return Link::RS_ERROR_STREAMS_CHANGED;
+        }
+
+        const double Now = FPlatformTime::Seconds();
+        if (State.NextFrameTime == 0.0)
+            State.NextFrameTime = Now;
+
+        const double Wait = State.NextFrameTime - Now;
+        if (Wait > 0.0)
+        {
+            const double Timeout = FMath::Max(0, timeoutMs) / 1000.0;
+            FPlatformProcess::SleepNoStats(float(FMath::Min(Wait, Timeout)));
+            if (Wait > Timeout)
+                return Link::RS_ERROR_TIMEOUT;
+        }
+
+        const double Interval = double(Scenario.RateDenominator) / Scenario.RateNumerator;
+        // Don't try to catch up after a long stall, like d3 the loopback keeps requesting at its nominal rate.
+        State.NextFrameTime = FMath::Max(State.NextFrameTime + Interval, FPlatformTime::Seconds() - Interval);
+        const uint64_t Frame = ++State.FrameIndex;
+
+        if (Scenario.QuitAfterFrames && Frame >= Scenario.QuitAfterFrames)
+        {
+            State.Quit = true;
+            return Link::RS_ERROR_QUIT;
+        }
+        if (Scenario.TimeoutEvery && Frame % Scenario.TimeoutEvery == 0)
+            return Link::RS_ERROR_TIMEOUT;
+        if (Scenario.StreamsChangedEvery && Frame % Scenario.StreamsChangedEvery == 0)
+        {
+            ChangeStreams(State);
+            return Link::RS_ERROR_STREAMS_CHANGED; // the frame itself is served by the next await, as with the DLL
+        }
+
+        if (!data)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        data->tTracked = FrameTime(Frame);
+        data->localTime = data->tTracked;
+        data->localTimeDelta = Interval;
+        data->frameRateNumerator = Scenario.RateNumerator;
+        data->frameRateDenominator = Scenario.RateDenominator;
+        data->flags = Frame == 1 ? Link::FRAMEDATA_RESET : Link::FRAMEDATA_NO_FLAGS;
+        data->scene = 0;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_setFollower(int) { return Link::RS_ERROR_SUCCESS; }
+
+    Link::RS_ERROR Loopback_beginFollowerFrame(double tTracked)
+    {
+        FLoopbackState& State = *GLoopback;
+        if (State.Quit)
+            return Link::RS_ERROR_QUIT;
+        if (tTracked == DBL_MAX)
+            return Link::RS_ERROR_TIMEOUT;
+
+        const FLoopbackScenario& Scenario = State.Scenario;
+        State.FrameIndex = uint64_t(FMath::RoundToDouble(tTracked * Scenario.RateNumerator / Scenario.RateDenominator));
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getFrameParameters(uint64_t schemaHash, void* outParameterData, uint64_t outParameterDataSize)
+    {
+        const FLoopbackScene* Scene = FindScene(schemaHash);
+        if (!Scene)
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+
+        const double Time = FrameTime(GLoopback->FrameIndex);
+        float* Out = static_cast<float*>(outParameterData);
+        const uint64_t Capacity = outParameterDataSize / sizeof(float);
+        uint64_t iFloat = 0;
+        auto Write = [&](float Value)
+        {
+            if (iFloat < Capacity)
+                Out[iFloat] = Value;
+            ++iFloat;
+        };
+
+        for (size_t i = 0; i < Scene->Parameters.size(); ++i)
+        {
+            const FLoopbackParameter& Parameter = Scene->Parameters[i];
+            switch (Parameter.Type)
+            {
+            case Link::RS_PARAMETER_NUMBER:
+                Write(FMath::Lerp(Parameter.Number.min, Parameter.Number.max, Wave(Time, i)));
+                break;
+            case Link::RS_PARAMETER_EVENT:
+                // Increments once a second, which the scene selector treats as an invoke.
+                Write(float(uint64_t(Time)));
+                break;
+            case Link::RS_PARAMETER_POSE:
+            case Link::RS_PARAMETER_TRANSFORM:
+            {
+                const float Matrix[16] = {
+                    1.f, 0.f, 0.f, 0.f,
+                    0.f, 1.f, 0.f, 0.f,
+                    0.f, 0.f, 1.f, 0.f,
+                    Wave(Time, i) - 0.5f, 0.f, Wave(Time, i + 1) - 0.5f, 1.f,
+                };
+                for (float Value : Matrix)
+                    Write(Value);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        return iFloat * sizeof(float) == outParameterDataSize ? Link::RS_ERROR_SUCCESS : Link::RS_ERROR_INVALID_PARAMETERS;
+    }
+
+    Link::RS_ERROR Loopback_getFrameImageData(uint64_t schemaHash, Link::ImageFrameData* outParameterData, uint64_t outParameterDataCount)
+    {
+        const FLoopbackScene* Scene = FindScene(schemaHash);
+        if (!Scene)
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+
+        const FLoopbackScenario& Scenario = GLoopback->Scenario;
+        uint64_t iImage = 0;
+        for (const FLoopbackParameter& Parameter : Scene->Parameters)
+        {
+            if (Parameter.Type != Link::RS_PARAMETER_IMAGE)
+                continue;
+            if (iImage < outParameterDataCount)
+                outParameterData[iImage] = { Scenario.ImageWidth, Scenario.ImageHeight, Scenario.ImageFormat, int64_t(iImage + 1) };
+            ++iImage;
+        }
+
+        return iImage == outParameterDataCount ? Link::RS_ERROR_SUCCESS : Link::RS_ERROR_INVALID_PARAMETERS;
+    }
+
+    Link::RS_ERROR Loopback_getFrameImage(int64_t imageId, const Link::SenderFrame* data)
+    {
+        // Nothing to copy, the target texture keeps whatever the engine initialised it with.
+        return data ? Link::RS_ERROR_SUCCESS : Link::RS_ERROR_INVALID_PARAMETERS;
+    }
+
+    Link::RS_ERROR Loopback_getFrameText(uint64_t schemaHash, uint32_t textParamIndex, const char** outTextPtr)
+    {
+        const FLoopbackScene* Scene = FindScene(schemaHash);
+        if (!Scene)
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+        if (!outTextPtr)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        const std::vector<std::string>& Texts = GLoopback->Scenario.Texts;
+        *outTextPtr = Texts[textParamIndex % Texts.size()].c_str();
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getSkeletonLayout(uint64_t schemaHash, uint64_t id, Link::SkeletonLayout* layout, int* numJoints)
+    {
+        if (!FindScene(schemaHash))
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        const int Joints = int(GLoopback->Scenario.SkeletonJoints);
+        if (layout)
+        {
+            if (*numJoints < Joints)
+                return Link::RS_ERROR_BUFFER_OVERFLOW;
+            layout->version = 1;
+            for (int i = 0; i < Joints; ++i)
+                layout->joints[i] = { uint64_t(i + 1), uint64_t(i), { 0.f, 0.1f, 0.f, 0.f, 0.f, 0.f, 1.f } };
+        }
+        *numJoints = Joints;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getSkeletonJointNames(uint64_t schemaHash, uint64_t layoutId, const char** names, int** nameByteLengths, int* numJoints)
+    {
+        if (!FindScene(schemaHash))
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        const int Joints = FMath::Min(*numJoints, int(GLoopback->Scenario.SkeletonJoints));
+        for (int i = 0; i < Joints; ++i)
+        {
+            const size_t Length = strlen(JointNames[i]);
+            if (nameByteLengths && nameByteLengths[i])
+                *nameByteLengths[i] = int(Length);
+            if (names && names[i])
+                memcpy(const_cast<char*>(names[i]), JointNames[i], Length);
+        }
+        *numJoints = Joints;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getSkeletonJointPoses(uint64_t schemaHash, uint32_t poseParamIndex, Link::SkeletonPose* pose, int* numJoints)
+    {
+        if (!FindScene(schemaHash))
+            return Link::RS_ERROR_INCORRECTSCHEMA;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        const int Joints = int(GLoopback->Scenario.SkeletonJoints);
+        if (pose)
+        {
+            if (*numJoints < Joints)
+                return Link::RS_ERROR_BUFFER_OVERFLOW;
+
+            const double Time = FrameTime(GLoopback->FrameIndex);
+            pose->layoutId = poseParamIndex + 1;
+            pose->layoutVersion = 1;
+            pose->rootTransform = AnimatedTransform(Time, poseParamIndex);
+            for (int i = 0; i < Joints; ++i)
+                pose->joints[i] = { uint64_t(i + 1), AnimatedTransform(Time, i) };
+        }
+        *numJoints = Joints;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_getFrameCamera(Link::StreamHandle streamHandle, Link::CameraData* outCameraData)
+    {
+        const FLoopbackStream* Stream = FindStream(streamHandle);
+        if (!Stream || !outCameraData)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        if (GLoopback->FrameIndex % Stream->RequestEvery != 0)
+            return Link::RS_ERROR_NOTFOUND;
+
+        const FLoopbackScenario& Scenario = GLoopback->Scenario;
+        const double Time = FrameTime(GLoopback->FrameIndex);
+        const double Angle = 2.0 * PI * Time / FMath::Max(0.001f, Scenario.CameraPeriod);
+
+        Link::CameraData Camera = {};
+        Camera.id = streamHandle;
+        Camera.cameraHandle = Scenario.CameraHandle;
+        Camera.x = float(Scenario.CameraRadius * FMath::Sin(Angle));
+        Camera.y = Scenario.CameraHeight;
+        Camera.z = float(-Scenario.CameraRadius * FMath::Cos(Angle));
+        Camera.rx = 0.f;
+        Camera.ry = float(FMath::RadiansToDegrees(-Angle));
+        Camera.rz = 0.f;
+        Camera.focalLength = Scenario.FocalLength;
+        Camera.sensorX = Scenario.SensorX;
+        Camera.sensorY = Scenario.SensorX * Stream->Height / FMath::Max(1u, Stream->Width);
+        Camera.cx = 0.f;
+        Camera.cy = 0.f;
+        Camera.nearZ = Scenario.NearZ;
+        Camera.farZ = Scenario.FarZ;
+        Camera.orthoWidth = Scenario.OrthoWidth;
+        *outCameraData = Camera;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_sendFrame(Link::StreamHandle streamHandle, const Link::SenderFrame* data, const void* frameData)
+    {
+        if (!FindStream(streamHandle))
+            return Link::RS_ERROR_INVALIDHANDLE;
+        GLoopback->FramesSent.fetch_add(1, std::memory_order_relaxed);
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    Link::RS_ERROR Loopback_releaseImage(const Link::SenderFrame*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_logToD3(const char*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_sendProfilingData(Link::ProfilingEntry*, int) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Loopback_setNewStatusMessage(const char*) { return Link::RS_ERROR_SUCCESS; }
+}
+
+FString RenderStreamLoopback::GetRequestedScenario()
+{
+    return FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_LOOPBACK"));
+}
+
+bool RenderStreamLoopback::Bind(RenderStreamLink& Link, const FString& ScenarioPath)
+{
+    TUniquePtr<FLoopbackState> State = MakeUnique<FLoopbackState>();
+    if (!LoadScenario(ScenarioPath, State->Scenario))
+        return false;
+
+    UE_LOG(LogRenderStream, Log, TEXT("Loopback: serving %d streams at %u/%u fps from '%s'"),
+        int32(State->Scenario.Streams.size()), State->Scenario.RateNumerator, State->Scenario.RateDenominator, *ScenarioPath);
+    GLoopback = MoveTemp(State);
+
+    Link.rs_registerLoggingFunc = &Loopback_registerLogging;
+    Link.rs_registerErrorLoggingFunc = &Loopback_registerLogging;
+    Link.rs_registerVerboseLoggingFunc = &Loopback_registerLogging;
+    Link.rs_unregisterLoggingFunc = &Loopback_unregisterLogging;
+    Link.rs_unregisterErrorLoggingFunc = &Loopback_unregisterLogging;
+    Link.rs_unregisterVerboseLoggingFunc = &Loopback_unregisterLogging;
+
+    Link.rs_initialise = &Loopback_initialise;
+    Link.rs_initialiseGpGpuWithDX11Device = &Loopback_initialiseGpGpuWithDX11Device;
+    Link.rs_initialiseGpGpuWithDX12DeviceAndQueue = &Loopback_initialiseGpGpuWithDX12DeviceAndQueue;
+    Link.rs_initialiseGpGpuWithOpenGlContexts = &Loopback_initialiseGpGpuWithOpenGlContexts;
+    Link.rs_initialiseGpGpuWithVulkanDevice = &Loopback_initialiseGpGpuWithVulkanDevice;
+    Link.rs_useDX12SharedHeapFlag = &Loopback_useDX12SharedHeapFlag;
+    Link.rs_setSchema = &Loopback_setSchema;
+    Link.rs_saveSchema = &Loopback_saveSchema;
+    Link.rs_loadSchema = &Loopback_loadSchema;
+    Link.rs_shutdown = &Loopback_shutdown;
+    Link.rs_getStreams = &Loopback_getStreams;
+    Link.rs_awaitFrameData = &Loopback_awaitFrameData;
+    Link.rs_setFollower = &Loopback_setFollower;
+    Link.rs_beginFollowerFrame = &Loopback_beginFollowerFrame;
+    Link.rs_getFrameParameters = &Loopback_getFrameParameters;
+    Link.rs_getFrameImageData = &Loopback_getFrameImageData;
+    Link.rs_getFrameImage2 = &Loopback_getFrameImage;
+    Link.rs_getFrameText = &Loopback_getFrameText;
+    Link.rs_getSkeletonLayout = &Loopback_getSkeletonLayout;
+    Link.rs_getSkeletonJointNames = &Loopback_getSkeletonJointNames;
+    Link.rs_getSkeletonJointPoses = &Loopback_getSkeletonJointPoses;
+    Link.rs_getFrameCamera = &Loopback_getFrameCamera;
+    Link.rs_sendFrame2 = &Loopback_sendFrame;
+    Link.rs_releaseImage2 = &Loopback_releaseImage;
+    Link.rs_logToD3 = &Loopback_logToD3;
+    Link.rs_sendProfilingData = &Loopback_sendProfilingData;
+    Link.rs_setNewStatusMessage = &Loopback_setNewStatusMessage;
+    return true;
+}
+
+void RenderStreamLoopback::Unbind()
+{
+    if (GLoopback)
+        UE_LOG(LogRenderStream, Log, TEXT("Loopback: %llu frames sent over %llu requested frames"), GLoopback->FramesSent.load(), GLoopback->FrameIndex);
+    GLoopback.Reset();
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+
+// In-process stand-in for d3renderstream.dll.
+//
+// When the RENDERSTREAM_LOOPBACK environment variable points at a scenario file, RenderStreamLink binds every
+// rs_* entry point to this provider instead of loading the DLL from the d3 install. Frames, cameras, streams,
+// parameters, text, images and skeleton poses are generated from the scenario at a fixed rate, so the frame loop
+// can be benchmarked repeatably (e.g. under -nullrhi) without a designer machine.
+//
+// RENDERSTREAM_LOOPBACK_RATE and RENDERSTREAM_LOOPBACK_STREAMS override the scenario's request rate and stream count.
+namespace RenderStreamLoopback
+{
+    // Scenario path requested through the environment, empty if loopback was not requested.
+    FString GetRequestedScenario();
+
+    // Points every rs_* function of Link at the loopback implementation, returns false if the scenario is invalid.
+    bool Bind(RenderStreamLink& Link, const FString& ScenarioPath);
+    void Unbind();
+}
@@ -28,6 +28,7 @@ FString FRenderStreamProjectionPolicy::RenderStreamPolicyType = TEXT("renderstre
 
 FRenderStreamProjectionPolicy::FRenderStreamProjectionPolicy(const FString& _ProjectionPolicyId, const struct FDisplayClusterConfigurationProjection* InConfigurationProjectionPolicy)
     : ProjectionPolicyId(_ProjectionPolicyId)
+    , ViewportHandle(INDEX_NONE)
     , Parameters(InConfigurationProjectionPolicy->Parameters)
     , NCP(0)
     , FCP(0)
@@ -50,6 +51,8 @@ bool FRenderStreamProjectionPolicy::HandleStartScene(class IDisplayClusterViewpo
         return false;
     }
 
+    ViewportHandle = Module->InternViewport(ViewportId);
+
     auto Stream = Module->StreamPool->GetStream(ViewportId);
     if (Stream)
     {
@@ -65,7 +68,8 @@ void FRenderStreamProjectionPolicy::HandleEndScene(class IDisplayClusterViewport
     FRenderStreamModule* Module = FRenderStreamModule::Get();
     check(Module);
 
-    Module->GetViewportInfo(Viewport->GetId()).Camera = nullptr;
+    if (ViewportHandle != INDEX_NONE)
+        Module->GetViewportInfo(ViewportHandle).Camera = nullptr;
 }
 
 bool FRenderStreamProjectionPolicy::CalculateView(class IDisplayClusterViewport* InViewport, const uint32 InContextNum, FVector& InOutViewLocation, FRotator& InOutViewRotation, const FVector& ViewOffset, const float WorldToMeters, const float InNCP, const float InFCP)
@@ -75,8 +79,8 @@ bool FRenderStreamProjectionPolicy::CalculateView(class IDisplayClusterViewport*
     FRenderStreamModule* Module = FRenderStreamModule::Get();
     check(Module);
 
-    auto& Info = Module->GetViewportInfo(InViewport->GetId());
-    UCameraComponent* AssignedCamera = Info.Camera.IsValid() ? Info.Camera->GetCameraComponent() : nullptr;
+    const FRenderStreamViewportInfo* Info = ViewportHandle != INDEX_NONE ? &Module->GetViewportInfo(ViewportHandle) : nullptr;
+    UCameraComponent* AssignedCamera = Info && Info->Camera.IsValid() ? Info->Camera->GetCameraComponent() : nullptr;
 
     InOutViewLocation = (AssignedCamera ? AssignedCamera->GetComponentLocation() : FVector::ZeroVector);
     InOutViewRotation = (AssignedCamera ? AssignedCamera->GetComponentRotation() : FRotator::ZeroRotator);
@@ -96,8 +100,8 @@ bool FRenderStreamProjectionPolicy::GetProjectionMatrix(class IDisplayClusterVie
     check(Module);
 
     auto const& ViewportId = InViewport->GetId();
-    auto& Info = Module->GetViewportInfo(ViewportId);
-    UCameraComponent* AssignedCamera = Info.Camera.IsValid() ? Info.Camera->GetCameraComponent() : nullptr;
+    FRenderStreamViewportInfo* Info = ViewportHandle != INDEX_NONE ? &Module->GetViewportInfo(ViewportHandle) : nullptr;
+    UCameraComponent* AssignedCamera = Info && Info->Camera.IsValid() ? Info->Camera->GetCameraComponent() : nullptr;
 
     if (!AssignedCamera)
     {
@@ -128,24 +132,31 @@ bool FRenderStreamProjectionPolicy::GetProjectionMatrix(class IDisplayClusterVie
         PrjMatrix = InViewport->GetContexts()[InContextNum].ProjectionMatrix;
     }
 
+    auto Stream = Module->StreamPool->GetStream(ViewportId);
+    // A fragment group's leader renders the union of the fragments' clipping
+    const FStreamFragmentGroup* Group = Stream ? Module->StreamPool->GetFragmentGroup(ViewportId) : nullptr;
+    if (Group && Group->Leader != Stream)
+        Group = nullptr;
+
     // Center shift
     FVector centerShift = { 0.f, 0.f, 0.f };
+    RenderStreamLink::CameraResponseData thisFrameResponse;
+    bool hasFrameResponse = Info->m_frameResponses.Read(GFrameCounter, thisFrameResponse); // first frame can have no frame response.
+    for (int32 i = 0; Group && !hasFrameResponse && i < Group->Fragments.Num(); ++i)
     {
-        std::lock_guard<std::mutex> guard(Info.m_frameResponsesLock);
-        uint64 frameCounter = GFrameCounter;
-        if (Info.m_frameResponsesMap.count(frameCounter)) // Check current frame data exists
-        {
-            // first frame can have no frame response.
-            const RenderStreamLink::CameraResponseData& thisFrameResponse = Info.m_frameResponsesMap[frameCounter];
-            centerShift = { thisFrameResponse.camera.cx, thisFrameResponse.camera.cy, 0.f };
-        }
+        // The leader's own stream may not be requested, every fragment has the same camera
+        const int32 FragmentHandle = Group->Fragments[i].Stream->ViewportHandle();
+        hasFrameResponse = FragmentHandle != INDEX_NONE && Module->GetViewportInfo(FragmentHandle).m_frameResponses.Read(GFrameCounter, thisFrameResponse);
     }
+    if (hasFrameResponse)
+        centerShift = { thisFrameResponse.camera.cx, thisFrameResponse.camera.cy, 0.f };
 
-    auto Stream = Module->StreamPool->GetStream(ViewportId);
     // Clipping
     FTransform clippingTransform;
     RenderStreamLink::ProjectionClipping Clipping = { 0.f, 1.f, 0.f, 1.f };  // Default clipping in case no streams
-    if (Stream)
+    if (Group)
+        Clipping = Group->Clipping;
+    else if (Stream)
         Clipping = Stream->Clipping();
     FVector clippingScale = { 1.f / (Clipping.right - Clipping.left), -1.f / (Clipping.top - Clipping.bottom), 1.f };
     FVector clippingOffset = (FVector(1.f - (Clipping.right + Clipping.left), -1.f + (Clipping.top + Clipping.bottom), 0.f) + centerShift) * clippingScale;
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <malloc.h>
 #include "RenderStream.h"
+#include "RenderStreamAllocationCounter.h"
 #include "RenderStreamHelper.h"
 #include "RSUCHelpers.inl"
 #include "RenderStreamSettings.h"
@@ -392,21 +393,15 @@ size_t RenderStreamSceneSelector::ValidateParameters(const AActor* Root, RenderS
     return nParameters;
 }
 
-void RenderStreamSceneSelector::ApplyParameters(uint32_t sceneId, const TArray<AActor*>& Actors)
+bool FFrameParameterBlock::Layout(const RenderStreamLink::RemoteParameters& Scene)
 {
-    if (sceneId >= Schema().scenes.nScenes)
-    {
-        UE_LOG(LogRenderStream, Fatal, TEXT("Error attempting to select scene %d out of %d scenes. Ensure that all relevant scenes have been loaded in the Unreal Editor at least once."), sceneId, Schema().scenes.nScenes);
-    }
-    const RenderStreamLink::RemoteParameters& params = Schema().scenes.scenes[sceneId];
-
     size_t nFloatParams = 0;
     size_t nImageParams = 0;
     size_t nTextParams = 0;
     size_t nPoseParams = 0;
-    for (size_t i = 0; i < params.nParameters ; ++i)
+    for (size_t i = 0; i < Scene.nParameters; ++i)
     {
-        const RenderStreamLink::RemoteParameter& param = params.parameters[i];
+        const RenderStreamLink::RemoteParameter& param = Scene.parameters[i];
         switch (param.type)
         {
         case RenderStreamLink::RS_PARAMETER_NUMBER:
@@ -428,41 +423,218 @@ void RenderStreamSceneSelector::ApplyParameters(uint32_t sceneId, const TArray<A
             break;
         default:
             UE_LOG(LogRenderStream, Error, TEXT("Unhandled parameter type"));
-            return;
+            return false;
         }
     }
-    
-    std::vector<float> floatValues(nFloatParams);
-    std::vector<RenderStreamLink::ImageFrameData> imageValues(nImageParams);
 
-    RenderStreamLink::RS_ERROR res = RenderStreamLink::instance().rs_getFrameParameters(params.hash, floatValues.data(), floatValues.size() * sizeof(float));
+    Layout(Scene.hash, nFloatParams, nImageParams, nTextParams, nPoseParams);
+    return true;
+}
+
+void FFrameParameterBlock::Layout(uint64_t Hash, size_t NumFloats, size_t NumImages, size_t NumTexts, size_t NumPoses)
+{
+    m_numFloats = NumFloats;
+    m_numImages = NumImages;
+    m_numTexts = NumTexts;
+    m_imageOffset = Align(m_numFloats * sizeof(float), alignof(RenderStreamLink::ImageFrameData));
+    m_textOffset = Align(m_imageOffset + m_numImages * sizeof(RenderStreamLink::ImageFrameData), alignof(const char*));
+    const size_t size = m_textOffset + m_numTexts * sizeof(const char*);
+    m_values.assign((size + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+    m_poses.SetNum(int32(NumPoses));
+    m_hash = Hash;
+    m_laidOut = true;
+}
+
+bool FFrameParameterBlock::Fetch(const RenderStreamLink::RemoteParameters& Scene)
+{
+    if (m_distributed)
+    {
+        m_distributed = false;
+        if (Scene.hash == m_hash)
+            return true;
+        UE_LOG(LogRenderStream, Warning, TEXT("Frame bundle parameters are for a different scene, fetching them locally"));
+    }
+
+    if ((!m_laidOut || Scene.hash != m_hash) && !Layout(Scene))
+    {
+        m_laidOut = false;
+        return false;
+    }
+
+    RenderStreamLink& link = RenderStreamLink::instance();
+    RenderStreamLink::RS_ERROR res = link.rs_getFrameParameters(m_hash, Bytes(), m_numFloats * sizeof(float));
     if (res != RenderStreamLink::RS_ERROR_SUCCESS)
     {
         UE_LOG(LogRenderStream, Error, TEXT("Unable to get float frame parameters - %d"), res);
-        return;
+        return false;
     }
-    res = RenderStreamLink::instance().rs_getFrameImageData(params.hash, imageValues.data(), imageValues.size());
+    res = link.rs_getFrameImageData(m_hash, reinterpret_cast<RenderStreamLink::ImageFrameData*>(Bytes() + m_imageOffset), m_numImages);
     if (res != RenderStreamLink::RS_ERROR_SUCCESS)
     {
         UE_LOG(LogRenderStream, Error, TEXT("Unable to get image frame parameters - %d"), res);
+        return false;
+    }
+
+    // Text and skeletons have no bulk query, fetch them all here so the appliers never call out.
+    const char** texts = reinterpret_cast<const char**>(Bytes() + m_textOffset);
+    for (size_t i = 0; i < m_numTexts; ++i)
+    {
+        if (link.rs_getFrameText(m_hash, uint32_t(i), &texts[i]) != RenderStreamLink::RS_ERROR_SUCCESS)
+            texts[i] = nullptr;
+    }
+
+    for (int32 i = 0; i < m_poses.Num(); ++i)
+        FetchPose(uint32_t(i), m_poses[i]);
+
+    m_fetched = true;
+    return true;
+}
+
+void FFrameParameterBlock::SerializeBundle(FArchive& Ar)
+{
+    bool hasValues = Ar.IsSaving() ? m_fetched : false;
+    Ar << hasValues;
+    if (!hasValues)
+        return;
+
+    uint64 hash = m_hash;
+    uint32 numFloats = uint32(m_numFloats);
+    uint32 numImages = uint32(m_numImages);
+    uint32 numTexts = uint32(m_numTexts);
+    uint32 numPoses = uint32(m_poses.Num());
+    Ar << hash << numFloats << numImages << numTexts << numPoses;
+
+    if (Ar.IsLoading())
+    {
+        if (!m_laidOut || hash != m_hash || numFloats != m_numFloats || numImages != m_numImages || numTexts != m_numTexts || numPoses != uint32(m_poses.Num()))
+            Layout(hash, numFloats, numImages, numTexts, numPoses);
+    }
+
+    Ar.Serialize(Bytes(), m_numFloats * sizeof(float));
+    Ar.Serialize(Bytes() + m_imageOffset, m_numImages * sizeof(RenderStreamLink::ImageFrameData));
+
+    // Text is sent as length prefixed bytes, -1 for a text that failed to fetch
+    const char** texts = reinterpret_cast<const char**>(Bytes() + m_textOffset);
+    if (Ar.IsLoading())
+        m_textStorage.clear();
+    for (size_t i = 0; i < m_numTexts; ++i)
+    {
+        int32 length = Ar.IsSaving() && texts[i] ? int32(strlen(texts[i])) : -1;
+        Ar << length;
+        if (Ar.IsSaving())
+        {
+            if (length > 0)
+                Ar.Serialize(const_cast<char*>(texts[i]), length);
+        }
+        else if (length > Ar.TotalSize() - Ar.Tell())
+        {
+            Ar.SetError();
+            return;
+        }
+        else if (length >= 0)
+        {
+            const size_t offset = m_textStorage.size();
+            m_textStorage.resize(offset + length + 1);
+            Ar.Serialize(m_textStorage.data() + offset, length);
+            m_textStorage[offset + length] = '\0';
+            texts[i] = reinterpret_cast<const char*>(offset + 1); // storage may still grow, offsets are turned into pointers below
+        }
+        else
+        {
+            texts[i] = nullptr;
+        }
+    }
+    if (Ar.IsLoading())
+    {
+        for (size_t i = 0; i < m_numTexts; ++i)
+        {
+            if (texts[i])
+                texts[i] = m_textStorage.data() + (reinterpret_cast<size_t>(texts[i]) - 1);
+        }
+    }
+
+    for (FPose& pose : m_poses)
+    {
+        int32 result = int32(pose.Result);
+        int32 numJoints = pose.NumJoints;
+        Ar << result << numJoints;
+        Ar.Serialize(&pose.Pose, offsetof(RenderStreamLink::SkeletonPose, joints));
+        if (Ar.IsLoading())
+        {
+            if (numJoints < 0 || Ar.IsError())
+            {
+                Ar.SetError();
+                return;
+            }
+            pose.Result = RenderStreamLink::RS_ERROR(result);
+            pose.NumJoints = numJoints;
+            if (pose.Joints.Num() < numJoints)
+                pose.Joints.SetNum(numJoints);
+            pose.Pose.joints = pose.Joints.GetData();
+        }
+        Ar.Serialize(pose.Joints.GetData(), numJoints * sizeof(RenderStreamLink::SkeletonJointPose));
+    }
+
+    if (Ar.IsSaving())
+        m_fetched = false;
+    else
+        m_distributed = !Ar.IsError();
+}
+
+void FFrameParameterBlock::FetchPose(uint32_t iPose, FPose& Pose) const
+{
+    RenderStreamLink& link = RenderStreamLink::instance();
+
+    // Joint counts rarely change, so try last frame's size first and only query the size when that fails.
+    int nJoints = Pose.Joints.Num();
+    if (nJoints > 0)
+    {
+        Pose.Pose.joints = Pose.Joints.GetData();
+        Pose.Result = link.rs_getSkeletonJointPoses(m_hash, iPose, &Pose.Pose, &nJoints);
+        if (Pose.Result == RenderStreamLink::RS_ERROR_SUCCESS && nJoints <= Pose.Joints.Num())
+        {
+            Pose.NumJoints = nJoints;
+            return;
+        }
+    }
+
+    Pose.NumJoints = 0;
+    Pose.Result = link.rs_getSkeletonJointPoses(m_hash, iPose, nullptr, &nJoints);
+    if (Pose.Result != RenderStreamLink::RS_ERROR_SUCCESS || nJoints == 0)
         return;
+
+    Pose.Joints.SetNum(nJoints);
+    Pose.Pose.joints = Pose.Joints.GetData();
+    Pose.Result = link.rs_getSkeletonJointPoses(m_hash, iPose, &Pose.Pose, &nJoints);
+    if (Pose.Result == RenderStreamLink::RS_ERROR_SUCCESS)
+        Pose.NumJoints = nJoints;
+}
+
+void RenderStreamSceneSelector::ApplyParameters(uint32_t sceneId, const TArray<AActor*>& Actors)
+{
+    if (sceneId >= Schema().scenes.nScenes)
+    {
+        UE_LOG(LogRenderStream, Fatal, TEXT("Error attempting to select scene %d out of %d scenes. Ensure that all relevant scenes have been loaded in the Unreal Editor at least once."), sceneId, Schema().scenes.nScenes);
     }
+    const RenderStreamLink::RemoteParameters& params = Schema().scenes.scenes[sceneId];
+
+    if (!m_frameParameters.Fetch(params))
+        return;
 
-    // These are updated by ApplyParameters to allow each actor to operate on the next set of data.
-    const RenderStreamLink::RemoteParameter* paramsPtr = params.parameters;
-    const float* floatValuesPtr = floatValues.data();
-    const RenderStreamLink::ImageFrameData* imageValuesPtr = imageValues.data();
+    // Advanced by ApplyParameters to allow each actor to operate on the next set of data.
+    FFrameParameterBlock::FCursor cursor;
     for (AActor* actor : Actors)
     {
         if (!actor)
             continue; // it's convenient at the higher level to pass nulls if there's a pattern which can miss pieces
-        ApplyParameters(actor, params.hash, &paramsPtr, params.nParameters, &floatValuesPtr, floatValues.size(), &imageValuesPtr, imageValues.size());
+        ApplyParameters(actor, params, cursor);
     }
 
-    m_floatValuesLast = floatValues; // event parameters need to lookup previous values
+    // event parameters need to lookup previous values
+    m_floatValuesLast.assign(m_frameParameters.Floats(), m_frameParameters.Floats() + m_frameParameters.NumFloats());
 }
 
-void RenderStreamSceneSelector::ApplyParameters(AActor* Root, uint64_t specHash, const RenderStreamLink::RemoteParameter** ppParams, const size_t nParams, const float** ppFloatValues, const size_t nFloatVals, const RenderStreamLink::ImageFrameData** ppImageValues, const size_t nImageVals)
+void RenderStreamSceneSelector::ApplyParameters(AActor* Root, const RenderStreamLink::RemoteParameters& params, FFrameParameterBlock::FCursor& cursor)
 {
     auto toggle = FHardwareInfo::GetHardwareInfo(NAME_RHI);
     struct
@@ -480,14 +652,19 @@ void RenderStreamSceneSelector::ApplyParameters(AActor* Root, uint64_t specHash,
         { RenderStreamLink::RS_FMT_RGBX8, EPixelFormat::PF_R8G8B8A8 },
     };
 
+    const uint64_t specHash = params.hash;
+    const size_t nParams = params.nParameters - FMath::Min<size_t>(cursor.Param, params.nParameters);
     size_t iParam = 0;
     size_t iFloat = 0;
     size_t iImage = 0;
-    size_t iText = 0;
-    size_t iPose = 0;
+    size_t& iText = cursor.Text;
+    size_t& iPose = cursor.Pose;
 
-    const float* floatValues = *ppFloatValues;
-    const RenderStreamLink::ImageFrameData* imageValues = *ppImageValues;
+    const float* floatValues = m_frameParameters.Floats() + cursor.Float;
+    const size_t nFloatVals = m_frameParameters.NumFloats() - cursor.Float;
+    const RenderStreamLink::ImageFrameData* imageValues = m_frameParameters.Images() + cursor.Image;
+    const size_t nImageVals = m_frameParameters.NumImages() - cursor.Image;
+    const float* floatValuesLast = m_floatValuesLast.size() == m_frameParameters.NumFloats() ? m_floatValuesLast.data() + cursor.Float : nullptr;
 
     const URenderStreamSettings* settings = GetDefault<URenderStreamSettings>();
 
@@ -497,9 +674,11 @@ void RenderStreamSceneSelector::ApplyParameters(AActor* Root, uint64_t specHash,
         {
             if (FuncIt->HasAnyFunctionFlags(FUNC_BlueprintEvent) && FuncIt->HasAnyFunctionFlags(FUNC_BlueprintCallable))
             {
-                if (!m_floatValuesLast.data()) // first frame
+                if (!floatValuesLast) // first frame
                     break;
-                if (floatValues[iFloat] > m_floatValuesLast.data()[iFloat]) // value increment signals an invoke
+                if (iFloat >= nFloatVals)
+                    break;
+                if (floatValues[iFloat] > floatValuesLast[iFloat]) // value increment signals an invoke
                 {
                     uint8* Buffer = static_cast<uint8*>(FMemory_Alloca(FuncIt->ParmsSize));
                     FFrame Frame = FFrame(Root, *FuncIt, Buffer);
@@ -635,6 +814,7 @@ void RenderStreamSceneSelector::ApplyParameters(AActor* Root, uint64_t specHash,
                     Texture->ResizeTarget(frameData.width, frameData.height);
                 }
 
+                FRenderStreamAllocationScopeExclusion RenderCommandAllocation; // owned by the engine's render command queue
                 ENQUEUE_RENDER_COMMAND(GetTex)(
                 [this, toggle, Texture, frameData, iImage](FRHICommandListImmediate& RHICmdList)
                 {
@@ -709,64 +889,59 @@ void RenderStreamSceneSelector::ApplyParameters(AActor* Root, uint64_t specHash,
             FSoftObjectPath PropKey = o.ToSoftObjectPath();
             if (TSoftObjectPtr<USkeleton> Skeleton(PropKey); Skeleton.IsValid() || Skeleton.IsPending())
             {
-                ApplySkeletalPose(specHash, iPose++, Property->GetName(), PropKey);
+                ApplySkeletalPose(specHash, iPose++, Property->GetFName(), PropKey);
             }
         }
         else if (const FTextProperty* TextProperty = CastField<const FTextProperty>(Property))
         {
-            const char* cString = nullptr;
-            if (RenderStreamLink::instance().rs_getFrameText(specHash, iText, &cString) == RenderStreamLink::RS_ERROR_SUCCESS)
+            if (iText < m_frameParameters.NumTexts())
             {
-                TextProperty->SetPropertyValue_InContainer(Root, FText::FromString(UTF8_TO_TCHAR(cString)));
+                if (m_textValuesLast.size() != m_frameParameters.NumTexts())
+                    m_textValuesLast.resize(m_frameParameters.NumTexts());
+
+                const char* cString = m_frameParameters.Texts()[iText];
+                FTextValueLast& last = m_textValuesLast[iText];
+                if (cString && (last.Actor.Get() != Root || last.Value != cString))
+                {
+                    last.Actor = Root;
+                    last.Value.assign(cString);
+                    TextProperty->SetPropertyValue_InContainer(Root, FText::FromString(UTF8_TO_TCHAR(cString)));
+                }
             }
             ++iText;
         }
         ++iParam;
     }
 
-    *ppFloatValues += iFloat;
-    *ppImageValues += iImage;
-    *ppParams += iParam;
+    cursor.Float += iFloat;
+    cursor.Image += iImage;
+    cursor.Param += iParam;
 }
 
-void RenderStreamSceneSelector::ApplySkeletalPose(uint64_t specHash, size_t iPose, const FString& ParamKey, RenderStreamLink::FAnimDataKey& PropKey)
+void RenderStreamSceneSelector::ApplySkeletalPose(uint64_t specHash, size_t iPose, const FName& ParamKey, RenderStreamLink::FAnimDataKey& PropKey)
 {
     // first get the pose for this param index
-    RenderStreamLink::FSkeletalPose Pose;
+    if (iPose >= size_t(m_frameParameters.Poses().Num()))
+        return;
+    const FFrameParameterBlock::FPose& FramePose = m_frameParameters.Poses()[iPose];
+    if (FramePose.Result != RenderStreamLink::RS_ERROR_SUCCESS)
     {
-        RenderStreamLink::SkeletonPose rsPose{};
-
-        const auto isNotAssignedSkeleton = [](RenderStreamLink::RS_ERROR error, size_t nJoints)->bool {
-            return  error == RenderStreamLink::RS_ERROR_SUCCESS && nJoints == 0;
-        };
-
-        int nJoints;
-        if (const RenderStreamLink::RS_ERROR Err = RenderStreamLink::instance().rs_getSkeletonJointPoses(specHash, iPose, nullptr, &nJoints);
-            isNotAssignedSkeleton(Err, nJoints))
-        {
-            // not assigned skeleton is valid workflow; however we want to early out to avoid handling empty data
-            return;
-        }
-        else if (Err != RenderStreamLink::RS_ERROR_SUCCESS)
-        {
-            UE_LOG(LogRenderStream, Error, TEXT("RenderStream failed to get skeletal pose size for index %llu. Error: %d"), iPose, Err);
-            return;
-        }
-
-        Pose.joints.SetNum(nJoints);
-        rsPose.joints = Pose.joints.GetData();
-        if (const RenderStreamLink::RS_ERROR Err = RenderStreamLink::instance().rs_getSkeletonJointPoses(specHash, iPose, &rsPose, &nJoints);
-            Err  != RenderStreamLink::RS_ERROR_SUCCESS)
-        {
-            UE_LOG(LogRenderStream, Error, TEXT("RenderStream failed to get skeletal pose %llu with %d joints. Error: %d"), iPose, Err, nJoints);
-            return;
-        }
-
-        Pose.layoutId = rsPose.layoutId;
-        Pose.layoutVersion = rsPose.layoutVersion;
-        Pose.rootPosition = FVector3f(rsPose.rootTransform.x, rsPose.rootTransform.y, rsPose.rootTransform.z);
-        Pose.rootOrientation = FQuat4f(rsPose.rootTransform.rx, rsPose.rootTransform.ry, rsPose.rootTransform.rz, rsPose.rootTransform.rw);
+        UE_LOG(LogRenderStream, Error, TEXT("RenderStream failed to get skeletal pose %llu. Error: %d"), iPose, FramePose.Result);
+        return;
     }
+    if (FramePose.NumJoints == 0)
+    {
+        // not assigned skeleton is valid workflow; however we want to early out to avoid handling empty data
+        return;
+    }
+
+    RenderStreamLink::FSkeletalPose& Pose = m_poseScratch;
+    Pose.joints.SetNumUninitialized(FramePose.NumJoints, false);
+    FMemory::Memcpy(Pose.joints.GetData(), FramePose.Joints.GetData(), FramePose.NumJoints * sizeof(RenderStreamLink::SkeletonJointPose));
+    Pose.layoutId = FramePose.Pose.layoutId;
+    Pose.layoutVersion = FramePose.Pose.layoutVersion;
+    Pose.rootPosition = FVector3f(FramePose.Pose.rootTransform.x, FramePose.Pose.rootTransform.y, FramePose.Pose.rootTransform.z);
+    Pose.rootOrientation = FQuat4f(FramePose.Pose.rootTransform.rx, FramePose.Pose.rootTransform.ry, FramePose.Pose.rootTransform.rz, FramePose.Pose.rootTransform.rw);
 
     // check the layout cache for the layout associated with this pose
     const RenderStreamLink::FSkeletalLayout* Layout = m_skeletalLayoutCache.Find(Pose.layoutId);
@@ -6,4 +6,25 @@ URenderStreamSettings::URenderStreamSettings(const FObjectInitializer& ObjectIni
     : Super(ObjectInitializer)
     , SceneSelector(ERenderStreamSceneSelector::None)
     , GenerateEvents(true)
+    , DistributeFrameBundle(false)
+    , FrameAcquisition(ERenderStreamFrameAcquisition::GameThread)
+    , IdleWhenNotRequested(true)
+    , DriveEngineTimeStep(true)
+    , RenderOnDemand(true)
+    , RenderFragmentsOnce(false)
+    , DeduplicateStreams(true)
+    , StreamOutputBuffers(3)
+    , CameraPrediction(ERenderStreamCameraPrediction::None)
+    , CameraPredictionHorizon(33.f)
+    , CameraPredictionMaxSpeed(20.f)
+    , CameraPredictionMaxAngularSpeed(720.f)
+    , LogForwardingVerbosity(ERenderStreamLogVerbosity::Log)
+    , LogForwardingMaxLinesPerSecond(200)
+    , TelemetryWindowFrames(1)
+    , TelemetrySendInterval(1)
+    , TelemetrySendMin(false)
+    , TelemetrySendAvg(true)
+    , TelemetrySendMax(true)
+    , TelemetrySendP99(true)
+    , TelemetryStats({ TEXT("STAT_AwaitFrame"), TEXT("STAT_ReceiveFrame") })
 {}
@@ -7,3 +7,7 @@ DECLARE_STATS_GROUP(TEXT("RenderStream"), STATGROUP_RenderStream, STATCAT_Advanc
 
 DECLARE_CYCLE_STAT(TEXT("Await Frame (Controller)"), STAT_AwaitFrame, STATGROUP_RenderStream);
 DECLARE_CYCLE_STAT(TEXT("Receive Frame (Follower)"), STAT_ReceiveFrame, STATGROUP_RenderStream);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame Loop Allocations"), STAT_FrameLoopAllocations, STATGROUP_RenderStream);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Camera Responses Dropped"), STAT_CameraResponsesDropped, STATGROUP_RenderStream);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Camera Response Mismatches"), STAT_CameraResponseMismatches, STATGROUP_RenderStream);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Stream Output Stalls"), STAT_StreamOutputStalls, STATGROUP_RenderStream);
@@ -0,0 +1,170 @@
+#include "RenderStreamTelemetry.h"
+#include "RenderStream.h"
+#include "RenderStreamSettings.h"
+
+#include "Misc/ScopeLock.h"
+
+#include <algorithm>
+
+FRenderStreamTelemetry& FRenderStreamTelemetry::Get()
+{
+    static FRenderStreamTelemetry Telemetry;
+    return Telemetry;
+}
+
+FRenderStreamTelemetry::FRenderStreamTelemetry()
+    : m_metrics(MakeUnique<FMetric[]>(MaxMetrics))
+{
+    m_entries.Reserve(MaxMetrics * A_Count);
+}
+
+FRenderStreamMetric FRenderStreamTelemetry::RegisterMetric(const FString& Name)
+{
+    FScopeLock Lock(&m_registrationLock);
+
+    const int32 Num = m_numMetrics.load(std::memory_order_relaxed);
+    for (int32 i = 0; i < Num; ++i)
+    {
+        if (m_metrics[i].Name == Name)
+            return { i };
+    }
+
+    if (Num >= MaxMetrics)
+    {
+        UE_LOG(LogRenderStream, Warning, TEXT("Unable to register telemetry metric '%s', the limit of %d metrics is reached"), *Name, MaxMetrics);
+        return {};
+    }
+
+    FMetric& Metric = m_metrics[Num];
+    Metric.Name = Name;
+
+    const FTCHARToUTF8 Utf8Name(*Name);
+    const std::string BaseName(Utf8Name.Get(), Utf8Name.Length());
+    Metric.ExportNames[A_Min] = BaseName + " min";
+    Metric.ExportNames[A_Avg] = BaseName + " avg";
+    Metric.ExportNames[A_Max] = BaseName + " max";
+    Metric.ExportNames[A_P99] = BaseName + " p99";
+    Metric.ExportNames[A_Count] = BaseName;
+    Metric.bExported = IsExported(Name);
+    ResizeWindow(Metric);
+
+    // Publish the slot only once it is fully initialised, EndFrame and Record never look past m_numMetrics
+    m_numMetrics.store(Num + 1, std::memory_order_release);
+    return { Num };
+}
+
+void FRenderStreamTelemetry::Record(FRenderStreamMetric Metric, float Value)
+{
+    if (!Metric.IsValid())
+        return;
+
+    FMetric& Slot = m_metrics[Metric.Index];
+    uint32 Bits;
+    FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+    Slot.Value.store(Bits, std::memory_order_relaxed);
+    Slot.bRecorded.store(true, std::memory_order_release);
+}
+
+void FRenderStreamTelemetry::Configure(const URenderStreamSettings& Settings)
+{
+    FScopeLock Lock(&m_registrationLock);
+
+    m_windowFrames = FMath::Clamp(Settings.TelemetryWindowFrames, 1, 600);
+    m_sendInterval = FMath::Clamp(Settings.TelemetrySendInterval, 1, 600);
+    m_aggregates[A_Min] = Settings.TelemetrySendMin;
+    m_aggregates[A_Avg] = Settings.TelemetrySendAvg;
+    m_aggregates[A_Max] = Settings.TelemetrySendMax;
+    m_aggregates[A_P99] = Settings.TelemetrySendP99;
+    m_exportFilter = Settings.TelemetryMetrics;
+
+    m_scratch.Reset();
+    m_scratch.Reserve(m_windowFrames);
+    m_framesSinceSend = 0;
+
+    const int32 Num = m_numMetrics.load(std::memory_order_relaxed);
+    for (int32 i = 0; i < Num; ++i)
+    {
+        m_metrics[i].bExported = IsExported(m_metrics[i].Name);
+        ResizeWindow(m_metrics[i]);
+    }
+}
+
+bool FRenderStreamTelemetry::IsExported(const FString& Name) const
+{
+    return m_exportFilter.Num() == 0 || m_exportFilter.Contains(Name);
+}
+
+void FRenderStreamTelemetry::ResizeWindow(FMetric& Metric) const
+{
+    Metric.Window.SetNumZeroed(m_windowFrames);
+    Metric.WindowHead = 0;
+    Metric.WindowCount = 0;
+    Metric.bRecordedSinceSend = false;
+}
+
+void FRenderStreamTelemetry::EndFrame()
+{
+    const int32 Num = m_numMetrics.load(std::memory_order_acquire);
+    for (int32 i = 0; i < Num; ++i)
+    {
+        FMetric& Metric = m_metrics[i];
+        if (!Metric.bRecorded.exchange(false, std::memory_order_acquire))
+            continue;
+
+        const uint32 Bits = Metric.Value.load(std::memory_order_relaxed);
+        FMemory::Memcpy(&Metric.Window[Metric.WindowHead], &Bits, sizeof(Bits));
+        Metric.WindowHead = (Metric.WindowHead + 1) % m_windowFrames;
+        Metric.WindowCount = FMath::Min(Metric.WindowCount + 1, m_windowFrames);
+        Metric.bRecordedSinceSend = true;
+    }
+
+    if (++m_framesSinceSend < m_sendInterval)
+        return;
+    m_framesSinceSend = 0;
+
+    m_entries.Reset();
+    for (int32 i = 0; i < Num; ++i)
+    {
+        // Metrics nobody recorded since the last send are skipped rather than repeating a stale window
+        FMetric& Metric = m_metrics[i];
+        if (!Metric.bExported || !Metric.bRecordedSinceSend)
+            continue;
+        Metric.bRecordedSinceSend = false;
+
+        if (m_windowFrames == 1)
+        {
+            m_entries.Push({ Metric.ExportNames[A_Count].c_str(), Metric.Window[0] });
+            continue;
+        }
+
+        // Until the window has wrapped the samples are at the front of it
+        float Min = Metric.Window[0];
+        float Max = Metric.Window[0];
+        double Sum = 0.0;
+        for (int32 s = 0; s < Metric.WindowCount; ++s)
+        {
+            const float Sample = Metric.Window[s];
+            Min = FMath::Min(Min, Sample);
+            Max = FMath::Max(Max, Sample);
+            Sum += Sample;
+        }
+
+        if (m_aggregates[A_Min])
+            m_entries.Push({ Metric.ExportNames[A_Min].c_str(), Min });
+        if (m_aggregates[A_Avg])
+            m_entries.Push({ Metric.ExportNames[A_Avg].c_str(), float(Sum / Metric.WindowCount) });
+        if (m_aggregates[A_Max])
+            m_entries.Push({ Metric.ExportNames[A_Max].c_str(), Max });
+        if (m_aggregates[A_P99])
+        {
+            m_scratch.Reset();
+            m_scratch.Append(Metric.Window.GetData(), Metric.WindowCount);
+            const int32 Rank = (99 * Metric.WindowCount + 99) / 100 - 1; // ceil(0.99 * n) - 1
+            std::nth_element(m_scratch.GetData(), m_scratch.GetData() + Rank, m_scratch.GetData() + m_scratch.Num());
+            m_entries.Push({ Metric.ExportNames[A_P99].c_str(), m_scratch[Rank] });
+        }
+    }
+
+    if (m_entries.Num() > 0)
+        RenderStreamLink::instance().rs_sendProfilingData(m_entries.GetData(), m_entries.Num());
+}
@@ -10,20 +10,9 @@ URenderStreamTimecodeProvider::URenderStreamTimecodeProvider(const class FObject
 
 FQualifiedFrameTime URenderStreamTimecodeProvider::GetQualifiedFrameTime() const
 {
-    const FRenderStreamSyncFrameData& syncData = FRenderStreamModule::Get()->m_syncFrame;
-    if (syncData.m_frameDataValid)
-    {
-        // The rate that d3 is sending new time values. Each new localtime value is in 1/render rate increments
-        const FFrameRate d3RenderRate(syncData.m_frameData.frameRateNumerator, syncData.m_frameData.frameRateDenominator);
-
-        const FTimecode timecode(syncData.m_frameData.localTime, d3RenderRate, false);
-
-        LastTime = FQualifiedFrameTime(timecode, d3RenderRate);
-    }
-
-    // Always return a valid time. If we have dropped a frame, or the d3 server has, we want to stay somewhere
-    // sensible.
-    return LastTime;
+    // Computed once per frame when the frame is applied. Always a valid time: if we have dropped a frame, or the d3
+    // server has, this stays on the last frame received.
+    return FRenderStreamModule::Get()->m_syncFrame.FrameTime;
 }
 
 ETimecodeProviderSynchronizationState URenderStreamTimecodeProvider::GetSynchronizationState() const
@@ -0,0 +1,1074 @@
+#include "RenderStreamTrace.h"
+#include "RenderStream.h"
+
+#include "Async/MappedFileHandle.h"
+#include "Containers/Queue.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+
+#include <atomic>
+
+namespace {
+    using Link = RenderStreamLink;
+
+    // File layout:
+    //   FTraceHeader
+    //   records: [uint32 type][uint32 payload size][uint64 keyA][uint64 keyB][uint32 variant][body]
+    //   trailer (written when capture stops): uint64 frame offsets[], FTraceFooter
+    // A trace whose capture did not stop cleanly has no trailer and is replayed by scanning the records.
+    constexpr uint32 TraceMagic = 0x52545352; // 'RSTR'
+    constexpr uint32 IndexMagic = 0x49545352; // 'RSTI'
+    constexpr uint32 TraceVersion = 1;
+
+    struct FTraceHeader
+    {
+        uint32 Magic;
+        uint32 Version;
+        uint32 ApiVersionMajor;
+        uint32 ApiVersionMinor;
+    };
+
+    struct FTraceFooter
+    {
+        uint64 FrameCount;
+        uint64 IndexOffset;
+        uint32 Magic;
+    };
+
+    enum class ERecord : uint32
+    {
+        AwaitFrameData,    // frame marker
+        BeginFollowerFrame,// frame marker
+        Streams,
+        LoadSchema,
+        SetSchema,
+        FrameCamera,
+        FrameParameters,
+        FrameImageData,
+        FrameText,
+        SkeletonLayout,
+        SkeletonJointNames,
+        SkeletonJointPoses,
+    };
+
+    constexpr uint32 RecordHeaderSize = sizeof(uint32) * 2;
+    constexpr uint32 NamesHaveLengths = 1;
+    constexpr uint32 NamesHaveStrings = 2;
+
+    bool IsFrameMarker(ERecord Type)
+    {
+        return Type == ERecord::AwaitFrameData || Type == ERecord::BeginFollowerFrame;
+    }
+
+    // Streams, schemas and skeleton layouts stay valid until replaced, everything else only for the frame it was captured in.
+    bool IsPersistent(ERecord Type)
+    {
+        return Type == ERecord::Streams || Type == ERecord::LoadSchema || Type == ERecord::SetSchema
+            || Type == ERecord::SkeletonLayout || Type == ERecord::SkeletonJointNames;
+    }
+
+    class FRecordWriter
+    {
+    public:
+        FRecordWriter(ERecord Type, uint64 KeyA = 0, uint64 KeyB = 0, uint32 Variant = 0)
+        {
+            Write(uint32(Type));
+            Write(uint32(0));
+            Write(KeyA);
+            Write(KeyB);
+            Write(Variant);
+        }
+
+        template<typename T>
+        void Write(const T& Value)
+        {
+            WriteBytes(&Value, sizeof(T));
+        }
+
+        void WriteBytes(const void* Bytes, uint64 Size)
+        {
+            Data.Append(static_cast<const uint8*>(Bytes), Size);
+        }
+
+        void WriteString(const char* Str)
+        {
+            const uint32 Length = Str ? uint32(strlen(Str)) : 0;
+            Write(Length);
+            WriteBytes(Str ? Str : "", Length);
+            Write('\0');
+        }
+
+        TArray<uint8> Finish()
+        {
+            const uint32 PayloadSize = uint32(Data.Num()) - RecordHeaderSize;
+            FMemory::Memcpy(Data.GetData() + sizeof(uint32), &PayloadSize, sizeof(uint32));
+            return MoveTemp(Data);
+        }
+
+    private:
+        TArray<uint8> Data;
+    };
+
+    class FRecordReader
+    {
+    public:
+        FRecordReader(const uint8* InData, uint32 InSize) : Data(InData), Size(InSize) {}
+
+        template<typename T>
+        T Read()
+        {
+            T Value{};
+            if (const uint8* Bytes = ReadBytes(sizeof(T)))
+                FMemory::Memcpy(&Value, Bytes, sizeof(T));
+            return Value;
+        }
+
+        const uint8* ReadBytes(uint64 Count)
+        {
+            const uint8* Result = Offset + Count <= Size ? Data + Offset : nullptr;
+            Offset += Count;
+            return Result;
+        }
+
+        // Strings are stored null terminated, so they can be handed out straight from the mapping.
+        const char* ReadString()
+        {
+            const uint32 Length = Read<uint32>();
+            const uint8* Bytes = ReadBytes(uint64(Length) + 1);
+            return Bytes ? reinterpret_cast<const char*>(Bytes) : "";
+        }
+
+        bool IsValid() const { return Offset <= Size; }
+
+    private:
+        const uint8* Data;
+        uint32 Size;
+        uint64 Offset = 0;
+    };
+
+    // Capture
+
+    class FTraceWriter : public FRunnable
+    {
+    public:
+        bool Open(const FString& Path)
+        {
+            File.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+            if (!File)
+                return false;
+
+            const FTraceHeader Header = { TraceMagic, TraceVersion, RENDER_STREAM_VERSION_MAJOR, RENDER_STREAM_VERSION_MINOR };
+            File->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+
+            WorkEvent = FPlatformProcess::GetSynchEventFromPool();
+            bStopThread = false;
+            Thread = FRunnableThread::Create(this, TEXT("RenderStreamTraceWriter"), 0, TPri_BelowNormal);
+            return Thread != nullptr;
+        }
+
+        void Close()
+        {
+            if (Thread)
+            {
+                Thread->Kill(true);
+                delete Thread;
+                Thread = nullptr;
+            }
+            if (WorkEvent)
+            {
+                FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+                WorkEvent = nullptr;
+            }
+            if (File)
+            {
+                Drain();
+                const FTraceFooter Footer = { uint64(FrameOffsets.Num()), uint64(File->Tell()), IndexMagic };
+                File->Write(reinterpret_cast<const uint8*>(FrameOffsets.GetData()), FrameOffsets.Num() * sizeof(uint64));
+                File->Write(reinterpret_cast<const uint8*>(&Footer), sizeof(Footer));
+                File.Reset();
+            }
+        }
+
+        void Push(TArray<uint8>&& Record)
+        {
+            Pending.Enqueue(MoveTemp(Record));
+            WorkEvent->Trigger();
+        }
+
+    private:
+        virtual uint32 Run() override
+        {
+            while (!bStopThread)
+            {
+                WorkEvent->Wait(100);
+                Drain();
+            }
+            return 0;
+        }
+
+        virtual void Stop() override
+        {
+            bStopThread = true;
+            WorkEvent->Trigger();
+        }
+
+        void Drain()
+        {
+            TArray<uint8> Record;
+            while (Pending.Dequeue(Record))
+            {
+                ERecord Type;
+                FMemory::Memcpy(&Type, Record.GetData(), sizeof(Type));
+                if (IsFrameMarker(Type))
+                    FrameOffsets.Add(uint64(File->Tell()));
+                File->Write(Record.GetData(), Record.Num());
+            }
+            File->Flush();
+        }
+
+        TUniquePtr<IFileHandle> File;
+        TQueue<TArray<uint8>, EQueueMode::Mpsc> Pending;
+        TArray<uint64> FrameOffsets;
+        FEvent* WorkEvent = nullptr;
+        FRunnableThread* Thread = nullptr;
+        std::atomic<bool> bStopThread{ false };
+    };
+
+    TUniquePtr<FTraceWriter> GWriter;
+
+    struct FCaptureOriginals
+    {
+        decltype(Link::rs_loadSchema) rs_loadSchema = nullptr;
+        decltype(Link::rs_setSchema) rs_setSchema = nullptr;
+        decltype(Link::rs_getStreams) rs_getStreams = nullptr;
+        decltype(Link::rs_awaitFrameData) rs_awaitFrameData = nullptr;
+        decltype(Link::rs_beginFollowerFrame) rs_beginFollowerFrame = nullptr;
+        decltype(Link::rs_getFrameParameters) rs_getFrameParameters = nullptr;
+        decltype(Link::rs_getFrameImageData) rs_getFrameImageData = nullptr;
+        decltype(Link::rs_getFrameText) rs_getFrameText = nullptr;
+        decltype(Link::rs_getSkeletonLayout) rs_getSkeletonLayout = nullptr;
+        decltype(Link::rs_getSkeletonJointNames) rs_getSkeletonJointNames = nullptr;
+        decltype(Link::rs_getSkeletonJointPoses) rs_getSkeletonJointPoses = nullptr;
+        decltype(Link::rs_getFrameCamera) rs_getFrameCamera = nullptr;
+    } GOriginals;
+
+    double GCaptureStart = 0.0;
+
+    void Submit(FRecordWriter& Record)
+    {
+        GWriter->Push(Record.Finish());
+    }
+
+    Link::RS_ERROR Capture_loadSchema(const char* assetPath, Link::Schema* schema, uint32_t* nBytes)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_loadSchema(assetPath, schema, nBytes);
+        if (Result == Link::RS_ERROR_SUCCESS)
+        {
+            FRecordWriter Record(ERecord::LoadSchema);
+            Record.Write(uint64(reinterpret_cast<UPTRINT>(schema)));
+            Record.Write(uint32(*nBytes));
+            Record.WriteBytes(schema, *nBytes);
+            Submit(Record);
+        }
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_setSchema(Link::Schema* schema)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_setSchema(schema);
+        FRecordWriter Record(ERecord::SetSchema);
+        Record.Write(int32(Result));
+        Record.Write(uint32(schema ? schema->scenes.nScenes : 0));
+        for (uint32_t i = 0; schema && i < schema->scenes.nScenes; ++i)
+            Record.Write(uint64(schema->scenes.scenes[i].hash));
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getStreams(Link::StreamDescriptions* streams, uint32_t* nBytes)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getStreams(streams, nBytes);
+        if (Result == Link::RS_ERROR_SUCCESS)
+        {
+            FRecordWriter Record(ERecord::Streams);
+            Record.Write(uint64(reinterpret_cast<UPTRINT>(streams)));
+            Record.Write(uint32(*nBytes));
+            Record.WriteBytes(streams, *nBytes);
+            Submit(Record);
+        }
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_awaitFrameData(int timeoutMs, Link::FrameData* data)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_awaitFrameData(timeoutMs, data);
+        FRecordWriter Record(ERecord::AwaitFrameData);
+        Record.Write(int32(Result));
+        Record.Write(FPlatformTime::Seconds() - GCaptureStart);
+        Record.Write(Result == Link::RS_ERROR_SUCCESS ? *data : Link::FrameData{});
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_beginFollowerFrame(double tTracked)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_beginFollowerFrame(tTracked);
+        FRecordWriter Record(ERecord::BeginFollowerFrame);
+        Record.Write(int32(Result));
+        Record.Write(FPlatformTime::Seconds() - GCaptureStart);
+        Record.Write(tTracked);
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getFrameParameters(uint64_t schemaHash, void* outParameterData, uint64_t outParameterDataSize)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getFrameParameters(schemaHash, outParameterData, outParameterDataSize);
+        FRecordWriter Record(ERecord::FrameParameters, schemaHash);
+        Record.Write(int32(Result));
+        Record.Write(uint64(outParameterDataSize));
+        Record.WriteBytes(outParameterData, outParameterDataSize);
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getFrameImageData(uint64_t schemaHash, Link::ImageFrameData* outParameterData, uint64_t outParameterDataCount)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getFrameImageData(schemaHash, outParameterData, outParameterDataCount);
+        FRecordWriter Record(ERecord::FrameImageData, schemaHash);
+        Record.Write(int32(Result));
+        Record.Write(uint64(outParameterDataCount));
+        Record.WriteBytes(outParameterData, outParameterDataCount * sizeof(Link::ImageFrameData));
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getFrameText(uint64_t schemaHash, uint32_t textParamIndex, const char** outTextPtr)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getFrameText(schemaHash, textParamIndex, outTextPtr);
+        FRecordWriter Record(ERecord::FrameText, schemaHash, textParamIndex);
+        Record.Write(int32(Result));
+        Record.WriteString(Result == Link::RS_ERROR_SUCCESS && outTextPtr ? *outTextPtr : nullptr);
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getSkeletonLayout(uint64_t schemaHash, uint64_t id, Link::SkeletonLayout* layout, int* numJoints)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getSkeletonLayout(schemaHash, id, layout, numJoints);
+        FRecordWriter Record(ERecord::SkeletonLayout, schemaHash, id, layout != nullptr);
+        Record.Write(int32(Result));
+        Record.Write(int32(numJoints ? *numJoints : 0));
+        if (layout && Result == Link::RS_ERROR_SUCCESS)
+        {
+            Record.Write(uint32(layout->version));
+            Record.WriteBytes(layout->joints, *numJoints * sizeof(Link::SkeletonJointDesc));
+        }
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getSkeletonJointNames(uint64_t schemaHash, uint64_t layoutId, const char** names, int** nameByteLengths, int* numJoints)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getSkeletonJointNames(schemaHash, layoutId, names, nameByteLengths, numJoints);
+        const uint32 Flags = (nameByteLengths ? NamesHaveLengths : 0) | (names ? NamesHaveStrings : 0);
+        FRecordWriter Record(ERecord::SkeletonJointNames, schemaHash, layoutId, Flags);
+        Record.Write(int32(Result));
+        const int32 Joints = numJoints ? *numJoints : 0;
+        Record.Write(Joints);
+        if (Result == Link::RS_ERROR_SUCCESS)
+        {
+            for (int32 i = 0; nameByteLengths && i < Joints; ++i)
+                Record.Write(int32(*nameByteLengths[i]));
+            for (int32 i = 0; names && i < Joints; ++i)
+                Record.WriteString(names[i]);
+        }
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getSkeletonJointPoses(uint64_t schemaHash, uint32_t poseParamIndex, Link::SkeletonPose* pose, int* numJoints)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getSkeletonJointPoses(schemaHash, poseParamIndex, pose, numJoints);
+        FRecordWriter Record(ERecord::SkeletonJointPoses, schemaHash, poseParamIndex, pose != nullptr);
+        Record.Write(int32(Result));
+        Record.Write(int32(numJoints ? *numJoints : 0));
+        if (pose && Result == Link::RS_ERROR_SUCCESS)
+        {
+            Record.Write(uint64(pose->layoutId));
+            Record.Write(uint32(pose->layoutVersion));
+            Record.Write(pose->rootTransform);
+            Record.WriteBytes(pose->joints, *numJoints * sizeof(Link::SkeletonJointPose));
+        }
+        Submit(Record);
+        return Result;
+    }
+
+    Link::RS_ERROR Capture_getFrameCamera(Link::StreamHandle streamHandle, Link::CameraData* outCameraData)
+    {
+        const Link::RS_ERROR Result = GOriginals.rs_getFrameCamera(streamHandle, outCameraData);
+        FRecordWriter Record(ERecord::FrameCamera, streamHandle);
+        Record.Write(int32(Result));
+        Record.Write(Result == Link::RS_ERROR_SUCCESS ? *outCameraData : Link::CameraData{});
+        Submit(Record);
+        return Result;
+    }
+
+    // Replay
+
+    struct FRecordKey
+    {
+        ERecord Type;
+        uint32 Variant;
+        uint64 A;
+        uint64 B;
+
+        bool operator==(const FRecordKey& Other) const
+        {
+            return Type == Other.Type && Variant == Other.Variant && A == Other.A && B == Other.B;
+        }
+
+        friend uint32 GetTypeHash(const FRecordKey& Key)
+        {
+            return HashCombine(HashCombine(::GetTypeHash(uint32(Key.Type)), ::GetTypeHash(Key.Variant)), HashCombine(::GetTypeHash(Key.A), ::GetTypeHash(Key.B)));
+        }
+    };
+
+    struct FRecordView
+    {
+        const uint8* Body = nullptr; // payload after the key
+        uint32 Size = 0;
+
+        FRecordReader Reader() const { return FRecordReader(Body, Size); }
+    };
+
+    struct FReplayState
+    {
+        TUniquePtr<IMappedFileHandle> Handle;
+        TUniquePtr<IMappedFileRegion> Region;
+        const uint8* Data = nullptr;
+        uint64 End = 0;    // end of the records, excluding the trailer
+        uint64 Cursor = 0; // next unread record
+
+        uint64 FrameCount = 0; // frames in the index, 0 when the trace has none
+        uint64 Frame = 0;
+        bool bPaced = false;
+        double WallStart = 0.0;
+
+        TMap<FRecordKey, FRecordView> FrameRecords;
+        TMap<FRecordKey, FRecordView> LatestRecords;
+    };
+
+    TUniquePtr<FReplayState> GReplay;
+
+    bool PeekRecord(uint64 Offset, ERecord& OutType, FRecordKey& OutKey, FRecordView& OutView, uint64& OutNext)
+    {
+        const FReplayState& State = *GReplay;
+        constexpr uint64 KeySize = sizeof(uint64) * 2 + sizeof(uint32);
+        if (Offset + RecordHeaderSize + KeySize > State.End)
+            return false;
+
+        uint32 Type, Size;
+        FMemory::Memcpy(&Type, State.Data + Offset, sizeof(uint32));
+        FMemory::Memcpy(&Size, State.Data + Offset + sizeof(uint32), sizeof(uint32));
+        if (Size < KeySize || Offset + RecordHeaderSize + Size > State.End)
+            return false;
+
+        FRecordReader Key(State.Data + Offset + RecordHeaderSize, uint32(KeySize));
+        OutType = ERecord(Type);
+        OutKey.Type = OutType;
+        OutKey.A = Key.Read<uint64>();
+        OutKey.B = Key.Read<uint64>();
+        OutKey.Variant = Key.Read<uint32>();
+        OutView.Body = State.Data + Offset + RecordHeaderSize + KeySize;
+        OutView.Size = uint32(Size - KeySize);
+        OutNext = Offset + RecordHeaderSize + Size;
+        return true;
+    }
+
+    // Consumes records up to (not including) the next frame marker into the lookup tables.
+    void ConsumeFrameRecords()
+    {
+        FReplayState& State = *GReplay;
+        ERecord Type;
+        FRecordKey Key;
+        FRecordView View;
+        uint64 Next;
+        while (PeekRecord(State.Cursor, Type, Key, View, Next) && !IsFrameMarker(Type))
+        {
+            (IsPersistent(Type) ? State.LatestRecords : State.FrameRecords).Add(Key, View);
+            State.Cursor = Next;
+        }
+    }
+
+    // Moves to the next frame marker of the expected kind and loads that frame's records.
+    bool NextFrame(ERecord Marker, FRecordView& OutMarker)
+    {
+        FReplayState& State = *GReplay;
+        ERecord Type;
+        FRecordKey Key;
+        uint64 Next;
+        while (PeekRecord(State.Cursor, Type, Key, OutMarker, Next))
+        {
+            State.Cursor = Next;
+            if (Type != Marker)
+            {
+                ConsumeFrameRecords();
+                continue;
+            }
+
+            State.FrameRecords.Reset();
+            ++State.Frame;
+            ConsumeFrameRecords();
+            return true;
+        }
+        return false;
+    }
+
+    // Moves to the marker of captured frame StartFrame through the index. Only the record headers before it are walked,
+    // to load the persistent records (streams, schema) the frame may depend on; per-frame records are skipped unread.
+    bool SeekFrame(uint64 StartFrame)
+    {
+        FReplayState& State = *GReplay;
+        if (StartFrame >= State.FrameCount)
+            return false;
+
+        uint64 Target;
+        FMemory::Memcpy(&Target, State.Data + State.End + StartFrame * sizeof(uint64), sizeof(Target));
+        if (Target < State.Cursor || Target >= State.End)
+            return false;
+
+        TMap<FRecordKey, FRecordView> LatestRecords = State.LatestRecords;
+        uint64 Cursor = State.Cursor;
+        ERecord Type;
+        FRecordKey Key;
+        FRecordView View;
+        uint64 Next;
+        while (Cursor < Target && PeekRecord(Cursor, Type, Key, View, Next))
+        {
+            if (IsPersistent(Type))
+                LatestRecords.Add(Key, View);
+            Cursor = Next;
+        }
+        if (Cursor != Target)
+            return false; // the index doesn't point at a record
+
+        State.LatestRecords = MoveTemp(LatestRecords);
+        State.FrameRecords.Reset();
+        State.Cursor = Cursor;
+        State.Frame = StartFrame;
+        return true;
+    }
+
+    const FRecordView* FindRecord(ERecord Type, uint64 A = 0, uint64 B = 0, uint32 Variant = 0)
+    {
+        const FRecordKey Key = { Type, Variant, A, B };
+        return (IsPersistent(Type) ? GReplay->LatestRecords : GReplay->FrameRecords).Find(Key);
+    }
+
+    // Buffers returned by rs_getStreams/rs_loadSchema are self-contained, copy them and move their pointers to the new base.
+    class FRelocator
+    {
+    public:
+        FRelocator(uint64 InOldBase, uint8* InNewBase, uint32 InSize) : OldBase(InOldBase), NewBase(InNewBase), Size(InSize) {}
+
+        template<typename T>
+        void Fix(T*& Ptr) const
+        {
+            const uint64 Address = uint64(reinterpret_cast<UPTRINT>(Ptr));
+            Ptr = Address >= OldBase && Address < OldBase + Size ? reinterpret_cast<T*>(NewBase + (Address - OldBase)) : nullptr;
+        }
+
+        void FixString(const char*& Str) const
+        {
+            Fix(Str);
+            if (!Str)
+                Str = "";
+        }
+
+    private:
+        uint64 OldBase;
+        uint8* NewBase;
+        uint32 Size;
+    };
+
+    template<typename T, typename RelocateFn>
+    Link::RS_ERROR ServeBuffer(ERecord Type, T* Out, uint32_t* nBytes, RelocateFn&& Relocate)
+    {
+        const FRecordView* View = FindRecord(Type);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!nBytes)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const uint64 OldBase = Reader.Read<uint64>();
+        const uint32 Size = Reader.Read<uint32>();
+        const uint8* Bytes = Reader.ReadBytes(Size);
+        if (!Bytes)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        if (!Out || *nBytes < Size)
+        {
+            *nBytes = Size;
+            return Link::RS_ERROR_BUFFER_OVERFLOW;
+        }
+
+        FMemory::Memcpy(Out, Bytes, Size);
+        Relocate(*Out, FRelocator(OldBase, reinterpret_cast<uint8*>(Out), Size));
+        *nBytes = Size;
+        return Link::RS_ERROR_SUCCESS;
+    }
+
+    void RelocateStreams(Link::StreamDescriptions& Streams, const FRelocator& R)
+    {
+        R.Fix(Streams.streams);
+        if (!Streams.streams)
+            Streams.nStreams = 0;
+        for (uint32_t i = 0; i < Streams.nStreams; ++i)
+        {
+            Link::StreamDescription& Stream = Streams.streams[i];
+            R.FixString(Stream.channel);
+            R.FixString(Stream.name);
+            R.FixString(Stream.mappingName);
+        }
+    }
+
+    void RelocateSchema(Link::Schema& Schema, const FRelocator& R)
+    {
+        R.FixString(Schema.engineName);
+        R.FixString(Schema.engineVersion);
+        R.FixString(Schema.pluginVersion);
+        R.FixString(Schema.info);
+
+        R.Fix(Schema.channels.channels);
+        if (!Schema.channels.channels)
+            Schema.channels.nChannels = 0;
+        for (uint32_t i = 0; i < Schema.channels.nChannels; ++i)
+            R.FixString(Schema.channels.channels[i]);
+
+        R.Fix(Schema.scenes.scenes);
+        if (!Schema.scenes.scenes)
+            Schema.scenes.nScenes = 0;
+        for (uint32_t i = 0; i < Schema.scenes.nScenes; ++i)
+        {
+            Link::RemoteParameters& Scene = Schema.scenes.scenes[i];
+            R.FixString(Scene.name);
+            R.Fix(Scene.parameters);
+            if (!Scene.parameters)
+                Scene.nParameters = 0;
+            for (uint32_t j = 0; j < Scene.nParameters; ++j)
+            {
+                Link::RemoteParameter& Parameter = Scene.parameters[j];
+                R.FixString(Parameter.group);
+                R.FixString(Parameter.displayName);
+                R.FixString(Parameter.key);
+                if (Parameter.type == Link::RS_PARAMETER_TEXT)
+                    R.FixString(Parameter.defaults.text.defaultValue);
+                R.Fix(Parameter.options);
+                if (!Parameter.options)
+                    Parameter.nOptions = 0;
+                for (uint32_t k = 0; k < Parameter.nOptions; ++k)
+                    R.FixString(Parameter.options[k]);
+            }
+        }
+    }
+
+    void Replay_registerLogging(Link::logger_t) {}
+    void Replay_unregisterLogging() {}
+    Link::RS_ERROR Replay_initialise(int expectedVersionMajor, int)
+    {
+        return expectedVersionMajor == RENDER_STREAM_VERSION_MAJOR ? Link::RS_ERROR_SUCCESS : Link::RS_ERROR_INCOMPATIBLE_VERSION;
+    }
+    Link::RS_ERROR Replay_initialiseGpGpuWithDX11Device(ID3D11Device*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_initialiseGpGpuWithDX12DeviceAndQueue(ID3D12Device*, ID3D12CommandQueue*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_initialiseGpGpuWithOpenGlContexts(HGLRC, HDC) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_initialiseGpGpuWithVulkanDevice(VkDevice) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_shutdown() { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_useDX12SharedHeapFlag(Link::UseDX12SharedHeapFlag* flag)
+    {
+        if (!flag)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        *flag = Link::RS_DX12_USE_SHARED_HEAP_FLAG;
+        return Link::RS_ERROR_SUCCESS;
+    }
+    Link::RS_ERROR Replay_saveSchema(const char*, Link::Schema*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_setFollower(int) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_getFrameImage(int64_t, const Link::SenderFrame* data) { return data ? Link::RS_ERROR_SUCCESS : Link::RS_ERROR_INVALID_PARAMETERS; }
+    Link::RS_ERROR Replay_sendFrame(Link::StreamHandle, const Link::SenderFrame*, const void*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_releaseImage(const Link::SenderFrame*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_logToD3(const char*) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_sendProfilingData(Link::ProfilingEntry*, int) { return Link::RS_ERROR_SUCCESS; }
+    Link::RS_ERROR Replay_setNewStatusMessage(const char*) { return Link::RS_ERROR_SUCCESS; }
+
+    Link::RS_ERROR Replay_loadSchema(const char*, Link::Schema* schema, uint32_t* nBytes)
+    {
+        return ServeBuffer(ERecord::LoadSchema, schema, nBytes, &RelocateSchema);
+    }
+
+    Link::RS_ERROR Replay_setSchema(Link::Schema* schema)
+    {
+        const FRecordView* View = FindRecord(ERecord::SetSchema);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!schema)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const uint32 nScenes = Reader.Read<uint32>();
+        for (uint32 i = 0; i < nScenes && i < schema->scenes.nScenes; ++i)
+            schema->scenes.scenes[i].hash = Reader.Read<uint64>();
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getStreams(Link::StreamDescriptions* streams, uint32_t* nBytes)
+    {
+        return ServeBuffer(ERecord::Streams, streams, nBytes, &RelocateStreams);
+    }
+
+    void Pace(double CapturedTime)
+    {
+        FReplayState& State = *GReplay;
+        if (!State.bPaced)
+            return;
+        if (State.WallStart == 0.0)
+            State.WallStart = FPlatformTime::Seconds() - CapturedTime;
+        const double Wait = State.WallStart + CapturedTime - FPlatformTime::Seconds();
+        if (Wait > 0.0)
+            FPlatformProcess::SleepNoStats(float(Wait));
+    }
+
+    Link::RS_ERROR Replay_awaitFrameData(int, Link::FrameData* data)
+    {
+        FRecordView Marker;
+        if (!NextFrame(ERecord::AwaitFrameData, Marker))
+            return Link::RS_ERROR_QUIT;
+
+        FRecordReader Reader = Marker.Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        Pace(Reader.Read<double>());
+        const Link::FrameData Frame = Reader.Read<Link::FrameData>();
+        if (Result == Link::RS_ERROR_SUCCESS && data)
+            *data = Frame;
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_beginFollowerFrame(double)
+    {
+        FRecordView Marker;
+        if (!NextFrame(ERecord::BeginFollowerFrame, Marker))
+            return Link::RS_ERROR_QUIT;
+
+        FRecordReader Reader = Marker.Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        Pace(Reader.Read<double>());
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getFrameParameters(uint64_t schemaHash, void* outParameterData, uint64_t outParameterDataSize)
+    {
+        const FRecordView* View = FindRecord(ERecord::FrameParameters, schemaHash);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const uint64 Size = Reader.Read<uint64>();
+        const uint8* Bytes = Reader.ReadBytes(Size);
+        if (!Bytes || Size != outParameterDataSize)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        FMemory::Memcpy(outParameterData, Bytes, Size);
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getFrameImageData(uint64_t schemaHash, Link::ImageFrameData* outParameterData, uint64_t outParameterDataCount)
+    {
+        const FRecordView* View = FindRecord(ERecord::FrameImageData, schemaHash);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const uint64 Count = Reader.Read<uint64>();
+        const uint8* Bytes = Reader.ReadBytes(Count * sizeof(Link::ImageFrameData));
+        if (!Bytes || Count != outParameterDataCount)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+        FMemory::Memcpy(outParameterData, Bytes, Count * sizeof(Link::ImageFrameData));
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getFrameText(uint64_t schemaHash, uint32_t textParamIndex, const char** outTextPtr)
+    {
+        const FRecordView* View = FindRecord(ERecord::FrameText, schemaHash, textParamIndex);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!outTextPtr)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        *outTextPtr = Reader.ReadString();
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getSkeletonLayout(uint64_t schemaHash, uint64_t id, Link::SkeletonLayout* layout, int* numJoints)
+    {
+        const FRecordView* View = FindRecord(ERecord::SkeletonLayout, schemaHash, id, layout != nullptr);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const int32 Joints = Reader.Read<int32>();
+        if (layout && Result == Link::RS_ERROR_SUCCESS)
+        {
+            if (*numJoints < Joints)
+                return Link::RS_ERROR_BUFFER_OVERFLOW;
+            layout->version = Reader.Read<uint32>();
+            const uint8* Bytes = Reader.ReadBytes(Joints * sizeof(Link::SkeletonJointDesc));
+            if (!Bytes)
+                return Link::RS_ERROR_INVALID_PARAMETERS;
+            FMemory::Memcpy(layout->joints, Bytes, Joints * sizeof(Link::SkeletonJointDesc));
+        }
+        *numJoints = Joints;
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getSkeletonJointNames(uint64_t schemaHash, uint64_t layoutId, const char** names, int** nameByteLengths, int* numJoints)
+    {
+        const uint32 Flags = (nameByteLengths ? NamesHaveLengths : 0) | (names ? NamesHaveStrings : 0);
+        const FRecordView* View = FindRecord(ERecord::SkeletonJointNames, schemaHash, layoutId, Flags);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const int32 Joints = FMath::Min(*numJoints, Reader.Read<int32>());
+        if (Result == Link::RS_ERROR_SUCCESS)
+        {
+            for (int32 i = 0; nameByteLengths && i < Joints; ++i)
+                *nameByteLengths[i] = Reader.Read<int32>();
+            for (int32 i = 0; names && i < Joints; ++i)
+            {
+                // The caller sized each buffer from the lengths returned by the previous call.
+                const char* Name = Reader.ReadString();
+                memcpy(const_cast<char*>(names[i]), Name, strlen(Name));
+            }
+        }
+        *numJoints = Joints;
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getSkeletonJointPoses(uint64_t schemaHash, uint32_t poseParamIndex, Link::SkeletonPose* pose, int* numJoints)
+    {
+        const FRecordView* View = FindRecord(ERecord::SkeletonJointPoses, schemaHash, poseParamIndex, pose != nullptr);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!numJoints)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        const int32 Joints = Reader.Read<int32>();
+        if (pose && Result == Link::RS_ERROR_SUCCESS)
+        {
+            if (*numJoints < Joints)
+                return Link::RS_ERROR_BUFFER_OVERFLOW;
+            pose->layoutId = Reader.Read<uint64>();
+            pose->layoutVersion = Reader.Read<uint32>();
+            pose->rootTransform = Reader.Read<Link::Transform>();
+            const uint8* Bytes = Reader.ReadBytes(Joints * sizeof(Link::SkeletonJointPose));
+            if (!Bytes)
+                return Link::RS_ERROR_INVALID_PARAMETERS;
+            FMemory::Memcpy(pose->joints, Bytes, Joints * sizeof(Link::SkeletonJointPose));
+        }
+        *numJoints = Joints;
+        return Result;
+    }
+
+    Link::RS_ERROR Replay_getFrameCamera(Link::StreamHandle streamHandle, Link::CameraData* outCameraData)
+    {
+        const FRecordView* View = FindRecord(ERecord::FrameCamera, streamHandle);
+        if (!View)
+            return Link::RS_ERROR_NOTFOUND;
+        if (!outCameraData)
+            return Link::RS_ERROR_INVALID_PARAMETERS;
+
+        FRecordReader Reader = View->Reader();
+        const Link::RS_ERROR Result = Link::RS_ERROR(Reader.Read<int32>());
+        *outCameraData = Reader.Read<Link::CameraData>();
+        return Result;
+    }
+}
+
+FString RenderStreamTrace::GetRequestedCapture()
+{
+    return FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_CAPTURE"));
+}
+
+FString RenderStreamTrace::GetRequestedReplay()
+{
+    return FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_REPLAY"));
+}
+
+bool RenderStreamTrace::StartCapture(RenderStreamLink& Link, const FString& Path)
+{
+    if (GWriter)
+        return true;
+
+    TUniquePtr<FTraceWriter> Writer = MakeUnique<FTraceWriter>();
+    if (!Writer->Open(Path))
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Failed to open RenderStream capture file %s."), *Path);
+        Writer->Close();
+        return false;
+    }
+    GWriter = MoveTemp(Writer);
+    GCaptureStart = FPlatformTime::Seconds();
+
+#define RS_CAPTURE(FUNC, WRAPPER) \
+    GOriginals.FUNC = Link.FUNC; \
+    Link.FUNC = &WRAPPER;
+
+    RS_CAPTURE(rs_loadSchema, Capture_loadSchema);
+    RS_CAPTURE(rs_setSchema, Capture_setSchema);
+    RS_CAPTURE(rs_getStreams, Capture_getStreams);
+    RS_CAPTURE(rs_awaitFrameData, Capture_awaitFrameData);
+    RS_CAPTURE(rs_beginFollowerFrame, Capture_beginFollowerFrame);
+    RS_CAPTURE(rs_getFrameParameters, Capture_getFrameParameters);
+    RS_CAPTURE(rs_getFrameImageData, Capture_getFrameImageData);
+    RS_CAPTURE(rs_getFrameText, Capture_getFrameText);
+    RS_CAPTURE(rs_getSkeletonLayout, Capture_getSkeletonLayout);
+    RS_CAPTURE(rs_getSkeletonJointNames, Capture_getSkeletonJointNames);
+    RS_CAPTURE(rs_getSkeletonJointPoses, Capture_getSkeletonJointPoses);
+    RS_CAPTURE(rs_getFrameCamera, Capture_getFrameCamera);
+#undef RS_CAPTURE
+
+    UE_LOG(LogRenderStream, Log, TEXT("Capturing RenderStream session to %s."), *Path);
+    return true;
+}
+
+void RenderStreamTrace::StopCapture(RenderStreamLink& Link)
+{
+    if (!GWriter)
+        return;
+
+    Link.rs_loadSchema = GOriginals.rs_loadSchema;
+    Link.rs_setSchema = GOriginals.rs_setSchema;
+    Link.rs_getStreams = GOriginals.rs_getStreams;
+    Link.rs_awaitFrameData = GOriginals.rs_awaitFrameData;
+    Link.rs_beginFollowerFrame = GOriginals.rs_beginFollowerFrame;
+    Link.rs_getFrameParameters = GOriginals.rs_getFrameParameters;
+    Link.rs_getFrameImageData = GOriginals.rs_getFrameImageData;
+    Link.rs_getFrameText = GOriginals.rs_getFrameText;
+    Link.rs_getSkeletonLayout = GOriginals.rs_getSkeletonLayout;
+    Link.rs_getSkeletonJointNames = GOriginals.rs_getSkeletonJointNames;
+    Link.rs_getSkeletonJointPoses = GOriginals.rs_getSkeletonJointPoses;
+    Link.rs_getFrameCamera = GOriginals.rs_getFrameCamera;
+
+    GWriter->Close();
+    GWriter.Reset();
+}
+
+bool RenderStreamTrace::BindReplay(RenderStreamLink& Link, const FString& Path)
+{
+    TUniquePtr<FReplayState> State = MakeUnique<FReplayState>();
+    State->Handle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path));
+    if (!State->Handle)
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Failed to map RenderStream trace %s."), *Path);
+        return false;
+    }
+
+    const int64 Size = State->Handle->GetFileSize();
+    State->Region.Reset(State->Handle->MapRegion(0, Size));
+    if (!State->Region || Size < int64(sizeof(FTraceHeader)))
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Failed to map RenderStream trace %s."), *Path);
+        return false;
+    }
+    State->Data = State->Region->GetMappedPtr();
+
+    FTraceHeader Header;
+    FMemory::Memcpy(&Header, State->Data, sizeof(Header));
+    if (Header.Magic != TraceMagic || Header.Version != TraceVersion || Header.ApiVersionMajor != RENDER_STREAM_VERSION_MAJOR)
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("%s is not a compatible RenderStream trace."), *Path);
+        return false;
+    }
+
+    State->Cursor = sizeof(FTraceHeader);
+    State->End = uint64(Size);
+    FTraceFooter Footer = {};
+    if (Size >= int64(sizeof(FTraceHeader) + sizeof(FTraceFooter)))
+        FMemory::Memcpy(&Footer, State->Data + Size - sizeof(FTraceFooter), sizeof(Footer));
+    if (Footer.Magic == IndexMagic && Footer.IndexOffset + Footer.FrameCount * sizeof(uint64) + sizeof(FTraceFooter) == uint64(Size))
+    {
+        State->End = Footer.IndexOffset;
+        State->FrameCount = Footer.FrameCount;
+    }
+    else
+    {
+        UE_LOG(LogRenderStream, Warning, TEXT("RenderStream trace %s has no frame index, capture was not stopped cleanly."), *Path);
+    }
+    State->bPaced = !FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_REPLAY_PACED")).IsEmpty();
+
+    GReplay = MoveTemp(State);
+    ConsumeFrameRecords(); // streams and schema captured before the first frame
+
+    const FString StartFrame = FPlatformMisc::GetEnvironmentVariable(TEXT("RENDERSTREAM_REPLAY_START_FRAME"));
+    if (!StartFrame.IsEmpty() && !SeekFrame(FCString::Strtoui64(*StartFrame, nullptr, 10)))
+        UE_LOG(LogRenderStream, Warning, TEXT("Unable to start replaying RenderStream trace %s at frame %s, starting at the first frame."), *Path, *StartFrame);
+
+    UE_LOG(LogRenderStream, Log, TEXT("Replaying RenderStream trace %s (%llu frames) from frame %llu."), *Path, GReplay->FrameCount, GReplay->Frame);
+
+    Link.rs_registerLoggingFunc = &Replay_registerLogging;
+    Link.rs_registerErrorLoggingFunc = &Replay_registerLogging;
+    Link.rs_registerVerboseLoggingFunc = &Replay_registerLogging;
+    Link.rs_unregisterLoggingFunc = &Replay_unregisterLogging;
+    Link.rs_unregisterErrorLoggingFunc = &Replay_unregisterLogging;
+    Link.rs_unregisterVerboseLoggingFunc = &Replay_unregisterLogging;
+
+    Link.rs_initialise = &Replay_initialise;
+    Link.rs_initialiseGpGpuWithDX11Device = &Replay_initialiseGpGpuWithDX11Device;
+    Link.rs_initialiseGpGpuWithDX12DeviceAndQueue = &Replay_initialiseGpGpuWithDX12DeviceAndQueue;
+    Link.rs_initialiseGpGpuWithOpenGlContexts = &Replay_initialiseGpGpuWithOpenGlContexts;
+    Link.rs_initialiseGpGpuWithVulkanDevice = &Replay_initialiseGpGpuWithVulkanDevice;
+    Link.rs_useDX12SharedHeapFlag = &Replay_useDX12SharedHeapFlag;
+    Link.rs_setSchema = &Replay_setSchema;
+    Link.rs_saveSchema = &Replay_saveSchema;
+    Link.rs_loadSchema = &Replay_loadSchema;
+    Link.rs_shutdown = &Replay_shutdown;
+    Link.rs_getStreams = &Replay_getStreams;
+    Link.rs_awaitFrameData = &Replay_awaitFrameData;
+    Link.rs_setFollower = &Replay_setFollower;
+    Link.rs_beginFollowerFrame = &Replay_beginFollowerFrame;
+    Link.rs_getFrameParameters = &Replay_getFrameParameters;
+    Link.rs_getFrameImageData = &Replay_getFrameImageData;
+    Link.rs_getFrameImage2 = &Replay_getFrameImage;
+    Link.rs_getFrameText = &Replay_getFrameText;
+    Link.rs_getSkeletonLayout = &Replay_getSkeletonLayout;
+    Link.rs_getSkeletonJointNames = &Replay_getSkeletonJointNames;
+    Link.rs_getSkeletonJointPoses = &Replay_getSkeletonJointPoses;
+    Link.rs_getFrameCamera = &Replay_getFrameCamera;
+    Link.rs_sendFrame2 = &Replay_sendFrame;
+    Link.rs_releaseImage2 = &Replay_releaseImage;
+    Link.rs_logToD3 = &Replay_logToD3;
+    Link.rs_sendProfilingData = &Replay_sendProfilingData;
+    Link.rs_setNewStatusMessage = &Replay_setNewStatusMessage;
+    return true;
+}
+
+void RenderStreamTrace::UnbindReplay()
+{
+    if (GReplay)
+        UE_LOG(LogRenderStream, Log, TEXT("RenderStream replay stopped after %llu frames."), GReplay->Frame);
+    GReplay.Reset();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "RenderStreamLink.h"
+
+// Recording and replay of RenderStream sessions.
+//
+// With RENDERSTREAM_CAPTURE set to a file path, the rs_* functions that return frame data (frame data, stream and schema
+// buffers, cameras, parameters, text, image descriptors, skeleton layouts and poses) are wrapped so their results are
+// appended to a binary trace by a background writer. A frame index is written as a trailer when capture stops.
+//
+// With RENDERSTREAM_REPLAY set to a trace, RenderStreamLink binds every rs_* function to a provider that memory maps the
+// trace and serves it back frame by frame, so ApplyParameters/ApplyCameras see exactly the captured input. Replay runs as
+// fast as the engine asks for frames unless RENDERSTREAM_REPLAY_PACED is set, in which case the captured cadence is kept.
+// RENDERSTREAM_REPLAY_START_FRAME starts replay at a captured frame, found through the frame index.
+namespace RenderStreamTrace
+{
+    FString GetRequestedCapture();
+    FString GetRequestedReplay();
+
+    bool StartCapture(RenderStreamLink& Link, const FString& Path);
+    void StopCapture(RenderStreamLink& Link);
+
+    bool BindReplay(RenderStreamLink& Link, const FString& Path);
+    void UnbindReplay();
+}
@@ -61,6 +61,7 @@
 //#include "Config/DisplayClusterConfigManager.h"
 
 #include "RenderStream.h"
+#include "RenderStreamSettings.h"
 
 URenderStreamViewportClient::URenderStreamViewportClient(FVTableHelper& Helper)
     : Super(Helper)
@@ -223,6 +224,23 @@ void URenderStreamViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanv
 		return UGameViewportClient::Draw(InViewport, SceneCanvas);
 	}
 
+	/// !!!! disguise customizations - nothing is drawn while d3 isn't requesting frames
+	const FRenderStreamModule* Module = FRenderStreamModule::Get();
+	if (Module && Module->IsIdle())
+	{
+		return;
+	}
+
+	// Viewports whose stream d3 didn't request this frame are left out of their view family
+	const bool bRenderOnDemand = GetDefault<URenderStreamSettings>()->RenderOnDemand;
+
+	// The post-process sends this frame's fragments with the groups its viewports are drawn with
+	if (Module && Module->StreamPool)
+	{
+		Module->StreamPool->CaptureFrameGroups();
+	}
+	/// !!!! disguise customizations
+
 	//Get world for render
 	UWorld* const MyWorld = GetWorld();
 
@@ -380,10 +398,16 @@ void URenderStreamViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanv
 				const FDisplayClusterViewport_Context ViewportContext = DCView.Viewport->GetContexts()[DCView.ContextNum];
 
 				/// !!!! disguise customizations
-				auto & Info = FRenderStreamModule::Get()->GetViewportInfo(DCView.Viewport->GetId());
-				if (Info.PlayerId != -1)
+				const TSharedPtr<IDisplayClusterProjectionPolicy, ESPMode::ThreadSafe>& Policy = DCView.Viewport->GetProjectionPolicy();
+				const int32 ViewportHandle = Policy.IsValid() && Policy->GetType() == FRenderStreamProjectionPolicy::RenderStreamPolicyType
+					? static_cast<const FRenderStreamProjectionPolicy*>(Policy.Get())->GetViewportHandle() : INDEX_NONE;
+				const FRenderStreamViewportInfo* Info = ViewportHandle != INDEX_NONE ? &FRenderStreamModule::Get()->GetViewportInfo(ViewportHandle) : nullptr;
+				// Fragments are cropped from their group leader's render, see FStreamFragmentGroup
+				const bool bCropped = Info && Info->FragmentLeader != INDEX_NONE && Info->FragmentLeader != ViewportHandle;
+				const bool bRequested = !bCropped && (!Info || !bRenderOnDemand || Info->RequestedFrame == GFrameCounter);
+				if (Info && Info->PlayerId != -1)
 				{
-					APlayerController * PolicyController = UGameplayStatics::GetPlayerControllerFromID(World, Info.PlayerId);
+					APlayerController * PolicyController = UGameplayStatics::GetPlayerControllerFromID(World, Info->PlayerId);
 					if (PolicyController)
 						LocalPlayer = PolicyController->GetLocalPlayer();
 				}
@@ -394,7 +418,7 @@ void URenderStreamViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanv
 				FRotator	ViewRotation;
 				FSceneView* View = RenderFrameViewportManager->CalcSceneView(LocalPlayer, &ViewFamily, ViewLocation, ViewRotation, InViewport, nullptr, ViewportContext.StereoViewIndex);
 
-				if (View && !DCView.IsViewportContextCanBeRendered())
+				if (View && (!DCView.IsViewportContextCanBeRendered() || !bRequested /* disguise customization */))
 				{
 					ViewFamily.Views.Remove(View);
 
@@ -407,7 +431,8 @@ void URenderStreamViewportClient::Draw(FViewport* InViewport, FCanvas* SceneCanv
 					Views.Add(View);
 
 					/// !!!! disguise customizations
-					UpdateView(&ViewFamily, View, Info);
+					if (Info)
+						UpdateView(&ViewFamily, View, *Info);
 					/// !!!! disguise customizations
 
 					// Apply viewport context settings to view (crossGPU, visibility, etc)
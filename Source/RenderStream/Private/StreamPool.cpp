@@ -1,6 +1,166 @@
 #include "StreamPool.h"
 #include "FrameStream.h"
 
+#include "RenderingThread.h"
+
+namespace
+{
+    // The render thread can be a couple of frames behind the game thread
+    constexpr uint64 FRAMES_IN_FLIGHT = 3;
+
+    // Rendering the union of fragments far apart renders the gap between them too
+    constexpr double MAX_UNION_OVERDRAW = 1.25;
+}
+
+FStreamPool::FStreamPool()
+{
+    Publish();
+}
+
+FStreamPool::~FStreamPool()
+{
+    m_snapshot.store(nullptr, std::memory_order_relaxed);
+}
+
+void FStreamPool::Publish()
+{
+    TUniquePtr<FStreamPoolSnapshot> Snapshot = MakeUnique<FStreamPoolSnapshot>();
+    Snapshot->States.Reserve(m_pool.Num());
+    Snapshot->ByName.Reserve(m_pool.Num());
+    Snapshot->ByHandle.Reserve(m_pool.Num());
+    for (const FFrameStreamPtr& Stream : m_pool)
+    {
+        Snapshot->States.Add(Stream->SharedState());
+
+        // The first of two streams with the same name wins, as it did with a linear search
+        if (!Snapshot->ByName.Contains(Stream->Name()))
+            Snapshot->ByName.Add(Stream->Name(), Stream);
+        if (Stream->Handle() != 0)
+            Snapshot->ByHandle.Add(Stream->Handle(), Stream);
+    }
+    if (m_groupFragments || m_groupDuplicates)
+        GroupStreams(*Snapshot);
+
+    m_snapshot.store(Snapshot.Get(), std::memory_order_release);
+    if (m_snapshotOwner)
+        m_retiredSnapshots.Emplace(GFrameCounter, MoveTemp(m_snapshotOwner));
+    m_snapshotOwner = MoveTemp(Snapshot);
+}
+
+void FStreamPool::GroupStreams(FStreamPoolSnapshot& Snapshot) const
+{
+    // In pool order, so a group keeps its leader while its streams don't change. Only streams of one mapping's viewpoint
+    // are known to share a camera, see FStreamFragmentGroup.
+    TMap<TTuple<uint64, int32, FString>, TArray<FFrameStreamPtr>> Views;
+    for (const FFrameStreamPtr& Stream : m_pool)
+    {
+        if (Stream->Handle() != 0 && Stream->Viewpoint() >= 0)
+            Views.FindOrAdd(MakeTuple(Stream->MappingId(), Stream->Viewpoint(), Stream->Channel())).Add(Stream);
+    }
+
+    for (const auto& View : Views)
+    {
+        if (View.Value.Num() < 2)
+            continue;
+
+        if (m_groupFragments)
+        {
+            AddGroup(Snapshot, View.Value);
+            continue;
+        }
+
+        // Only duplicates, streams of the view with the same clipping
+        TArray<FFrameStreamPtr> Remaining = View.Value;
+        while (Remaining.Num() > 1)
+        {
+            const RenderStreamLink::ProjectionClipping Clipping = Remaining[0]->Clipping();
+            TArray<FFrameStreamPtr> Duplicates;
+            for (int32 i = 0; i < Remaining.Num(); )
+            {
+                if (FMemory::Memcmp(&Remaining[i]->Clipping(), &Clipping, sizeof(Clipping)) == 0)
+                {
+                    Duplicates.Add(Remaining[i]);
+                    Remaining.RemoveAt(i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            if (Duplicates.Num() > 1)
+                AddGroup(Snapshot, Duplicates);
+        }
+    }
+}
+
+void FStreamPool::AddGroup(FStreamPoolSnapshot& Snapshot, const TArray<FFrameStreamPtr>& Streams)
+{
+    RenderStreamLink::ProjectionClipping Union = Streams[0]->Clipping();
+    double DensityX = 0.0;
+    double DensityY = 0.0;
+    double FragmentPixels = 0.0;
+    for (const FFrameStreamPtr& Stream : Streams)
+    {
+        const RenderStreamLink::ProjectionClipping& Clipping = Stream->Clipping();
+        const float Width = Clipping.right - Clipping.left;
+        const float Height = Clipping.bottom - Clipping.top;
+        if (Width <= 0.f || Height <= 0.f)
+            return;
+
+        Union.left = FMath::Min(Union.left, Clipping.left);
+        Union.right = FMath::Max(Union.right, Clipping.right);
+        Union.top = FMath::Min(Union.top, Clipping.top);
+        Union.bottom = FMath::Max(Union.bottom, Clipping.bottom);
+        DensityX = FMath::Max(DensityX, Stream->Resolution().X / double(Width));
+        DensityY = FMath::Max(DensityY, Stream->Resolution().Y / double(Height));
+        FragmentPixels += double(Stream->Resolution().X) * Stream->Resolution().Y;
+    }
+
+    const float UnionWidth = Union.right - Union.left;
+    const float UnionHeight = Union.bottom - Union.top;
+    const int32 MaxDimension = int32(GetMax2DTextureDimension());
+    const FIntPoint Resolution(
+        FMath::Min(FMath::CeilToInt(DensityX * UnionWidth), MaxDimension),
+        FMath::Min(FMath::CeilToInt(DensityY * UnionHeight), MaxDimension));
+    if (double(Resolution.X) * Resolution.Y > FragmentPixels * MAX_UNION_OVERDRAW)
+        return;
+
+    TSharedPtr<FStreamFragmentGroup> Group = MakeShared<FStreamFragmentGroup>();
+    Group->Leader = Streams[0];
+    Group->Clipping = Union;
+    Group->Resolution = Resolution;
+    for (const FFrameStreamPtr& Stream : Streams)
+    {
+        const RenderStreamLink::ProjectionClipping& Clipping = Stream->Clipping();
+        Group->Fragments.Add({ Stream, {
+            (Clipping.left - Union.left) / UnionWidth,
+            (Clipping.right - Union.left) / UnionWidth,
+            (Clipping.top - Union.top) / UnionHeight,
+            (Clipping.bottom - Union.top) / UnionHeight }, Group->Fragments.Num() });
+    }
+
+    // Fragments with the same crop, resolution and format have the same output, it is only blitted once
+    for (int32 i = 1; i < Group->Fragments.Num(); ++i)
+    {
+        FStreamFragmentGroup::FFragment& Fragment = Group->Fragments[i];
+        for (int32 j = 0; j < i; ++j)
+        {
+            const FStreamFragmentGroup::FFragment& Earlier = Group->Fragments[j];
+            if (Earlier.Source == j
+                && FMemory::Memcmp(&Earlier.Crop, &Fragment.Crop, sizeof(Fragment.Crop)) == 0
+                && Earlier.Stream->Resolution() == Fragment.Stream->Resolution()
+                && Earlier.Stream->Format() == Fragment.Stream->Format())
+            {
+                Fragment.Source = j;
+                break;
+            }
+        }
+    }
+
+    for (const FFrameStreamPtr& Stream : Streams)
+        Snapshot.GroupsByName.Add(Stream->Name(), Group);
+}
+
 bool FStreamPool::AddNewStreamToPool(const FString& StreamName, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt)
 {
     FFrameStreamPtr stream = MakeShared<FFrameStream, ESPMode::ThreadSafe>();
@@ -8,15 +168,72 @@ bool FStreamPool::AddNewStreamToPool(const FString& StreamName, const FIntPoint&
         return false;
 
     m_pool.Add(stream);
+    Publish();
     return true;
 }
 
-FFrameStreamPtr FStreamPool::GetStream(const FString& desiredStreamName)
+FFrameStreamPtr FStreamPool::GetStream(const FString& desiredStreamName) const
+{
+    const FStreamPoolSnapshot* Snapshot = m_snapshot.load(std::memory_order_acquire);
+    const FFrameStreamPtr* Found = Snapshot ? Snapshot->ByName.Find(desiredStreamName) : nullptr;
+    return Found ? *Found : nullptr;
+}
+
+FFrameStreamPtr FStreamPool::GetStreamByHandle(RenderStreamLink::StreamHandle Handle) const
+{
+    const FStreamPoolSnapshot* Snapshot = m_snapshot.load(std::memory_order_acquire);
+    const FFrameStreamPtr* Found = Snapshot ? Snapshot->ByHandle.Find(Handle) : nullptr;
+    return Found ? *Found : nullptr;
+}
+
+const FStreamFragmentGroup* FStreamPool::GetFragmentGroup(const FString& StreamName) const
+{
+    const FStreamPoolSnapshot* Snapshot = m_snapshot.load(std::memory_order_acquire);
+    const TSharedPtr<const FStreamFragmentGroup>* Found = Snapshot ? Snapshot->GroupsByName.Find(StreamName) : nullptr;
+    return Found ? Found->Get() : nullptr;
+}
+
+void FStreamPool::CaptureFrameGroups()
 {
-    auto It = m_pool.FindByPredicate([&desiredStreamName](const FFrameStreamPtr& stream) {
-        return stream->Name().Compare(desiredStreamName, ESearchCase::IgnoreCase) == 0;
+    // Snapshots outlive the frames in flight, so the rendering thread can keep using one the game thread has replaced
+    const FStreamPoolSnapshot* Snapshot = m_snapshot.load(std::memory_order_relaxed);
+    ENQUEUE_RENDER_COMMAND(RenderStreamFrameGroups)([this, Snapshot, Frame = GFrameCounter](FRHICommandListImmediate&) {
+        m_frameSnapshot = Snapshot;
+        m_frameSnapshotFrame = Frame;
     });
-    return It ? *It : nullptr;
+}
+
+const FStreamFragmentGroup* FStreamPool::GetFrameFragmentGroup_RenderThread(const FString& StreamName) const
+{
+    // A frame drawn without capturing, which only happens outside URenderStreamViewportClient, uses the latest groups
+    check(IsInRenderingThread());
+    if (!m_frameSnapshot || m_frameSnapshotFrame != GFrameCounterRenderThread)
+        return GetFragmentGroup(StreamName);
+
+    const TSharedPtr<const FStreamFragmentGroup>* Found = m_frameSnapshot->GroupsByName.Find(StreamName);
+    return Found ? Found->Get() : nullptr;
+}
+
+FIntPoint FStreamPool::GetRenderResolution(const FFrameStreamPtr& Stream) const
+{
+    const FStreamFragmentGroup* Group = GetFragmentGroup(Stream->Name());
+    return Group && Group->Leader == Stream ? Group->Resolution : Stream->Resolution();
+}
+
+void FStreamPool::SetGrouping(bool bFragments, bool bDuplicates)
+{
+    m_groupFragments = bFragments;
+    m_groupDuplicates = bDuplicates;
+    Publish();
+}
+
+EStreamChange FStreamPool::UpdateStream(const FFrameStreamPtr& Stream, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt)
+{
+    // Publishing retires the snapshot holding the stream's previous state, the rendering thread may still be reading it
+    const EStreamChange Changes = Stream->Update(Resolution, Channel, Clipping, Handle, Fmt);
+    if (Changes != EStreamChange::None && Changes != EStreamChange::Failed)
+        Publish();
+    return Changes;
 }
 
 FFrameStreamPtr FStreamPool::AllocateStreamFor(const FString& desiredStreamName, uint32 id)
@@ -28,6 +245,7 @@ FFrameStreamPtr FStreamPool::AllocateStreamFor(const FString& desiredStreamName,
         {
             m_allocated.Add(id, stream);
             m_pool.Remove(stream);
+            Publish();
             return m_allocated[id];
         }
     }
@@ -41,9 +259,30 @@ void FStreamPool::ReturnStreamFor(uint32 uid)
     {
         m_pool.Add(*found);
         m_allocated.Remove(uid);
+        Publish();
     }
 }
 
+void FStreamPool::RetireStream(const FFrameStreamPtr& Stream)
+{
+    if (m_pool.Remove(Stream) == 0)
+        return;
+
+    Stream->Retire();
+    m_retired.Emplace(GFrameCounter, Stream);
+    Publish();
+}
+
+void FStreamPool::CollectRetired()
+{
+    m_retired.RemoveAll([](const TPair<uint64, FFrameStreamPtr>& Retired) {
+        return GFrameCounter - Retired.Key > FRAMES_IN_FLIGHT;
+    });
+    m_retiredSnapshots.RemoveAll([](const TPair<uint64, TUniquePtr<const FStreamPoolSnapshot>>& Retired) {
+        return GFrameCounter - Retired.Key > FRAMES_IN_FLIGHT;
+    });
+}
+
 const TMap<uint32, FFrameStreamPtr>& FStreamPool::GetActiveStreams() const
 {
     return m_allocated;
@@ -5,6 +5,12 @@
 #include "RenderStream.h"
 #include "RenderStreamStats.h"
 #include "RenderStreamEventHandler.h"
+#include "RenderStreamSceneSelector.h"
+#include "RenderStreamSettings.h"
+#include "RenderStreamCustomTimeStep.h"
+
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 bool FRenderStreamSyncFrameData::IsActive() const
 {
@@ -17,65 +23,293 @@ FString FRenderStreamSyncFrameData::GetSyncId() const
     return SyncId;
 }
 
-FString FRenderStreamSyncFrameData::SerializeToString() const
+// Payload layout, every field little endian:
+//   u8  flags                 PF_* below
+//   u8  sequence              incremented for every payload sent
+//   [PF_Handshake]            u16 RenderStream major, u16 RenderStream minor, u8 data version, with every keyframe
+//   [PF_FrameDataValid]       u16 mask of the FrameData words that follow, u32 per set bit
+//   [PF_Bundle]               FRenderStreamFrameBundle, serialized with FArchive
+// Only words that changed since the previous payload are sent, unless PF_Keyframe is set, in which case all of them are.
+// The bytes are packed 6 bits per character so the string stays pure ANSI on the wire.
+// PF_Idle tells the followers the controller has stopped receiving requests and they can skip rendering too.
+namespace
 {
-    TArray<uint8> TempBytes;
-    FMemoryWriter Ar(TempBytes, /*bIsPersistent=*/ true);
-    const_cast<FRenderStreamSyncFrameData*>(this)->Map(Ar);
-    return BytesToString(TempBytes.GetData(), TempBytes.Num());
+    constexpr uint8 DATA_VERSION = 6;
+    constexpr int32 MaxStreamChangeAttempts = 4; // rs_awaitFrameData / rs_beginFollowerFrame calls per frame while streams keep changing
+    constexpr int32 KeyframeInterval = 600; // frames between full FrameData payloads, so a desynchronised follower recovers
+
+    enum EPayloadFlags : uint8
+    {
+        PF_Quitting = 1 << 0,
+        PF_FrameDataValid = 1 << 1,
+        PF_StreamsChanged = 1 << 2,
+        PF_Keyframe = 1 << 3,
+        PF_Handshake = 1 << 4,
+        PF_Bundle = 1 << 5,
+        PF_Idle = 1 << 6,
+    };
+
+    constexpr int32 FrameDataWords = sizeof(RenderStreamLink::FrameData) / sizeof(uint32);
+    static_assert(sizeof(RenderStreamLink::FrameData) % sizeof(uint32) == 0, "FrameData is delta encoded in 32 bit words");
+    static_assert(FrameDataWords <= 16, "FrameData word mask is 16 bits");
+
+    const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    struct FPayloadWriter
+    {
+        TArray<uint8>& Bytes;
+
+        void U8(uint8 Value) { Bytes.Add(Value); }
+        void U16(uint16 Value) { U8(uint8(Value)); U8(uint8(Value >> 8)); }
+        void U32(uint32 Value) { U16(uint16(Value)); U16(uint16(Value >> 16)); }
+    };
+
+    struct FPayloadReader
+    {
+        const TArray<uint8>& Bytes;
+        int32 Pos = 0;
+        bool bOverrun = false;
+
+        uint8 U8()
+        {
+            if (Pos >= Bytes.Num())
+            {
+                bOverrun = true;
+                return 0;
+            }
+            return Bytes[Pos++];
+        }
+        uint16 U16() { const uint16 Lo = U8(); return uint16(Lo | (uint16(U8()) << 8)); }
+        uint32 U32() { const uint32 Lo = U16(); return Lo | (uint32(U16()) << 16); }
+    };
+
+    FString Encode(const TArray<uint8>& Bytes)
+    {
+        const int32 NumChars = (Bytes.Num() * 8 + 5) / 6;
+        FString Str;
+        TArray<TCHAR>& Chars = Str.GetCharArray();
+        Chars.SetNumUninitialized(NumChars + 1);
+
+        int32 c = 0;
+        uint32 Bits = 0;
+        int32 NumBits = 0;
+        for (const uint8 Byte : Bytes)
+        {
+            Bits = (Bits << 8) | Byte;
+            NumBits += 8;
+            while (NumBits >= 6)
+            {
+                NumBits -= 6;
+                Chars[c++] = Alphabet[(Bits >> NumBits) & 63];
+            }
+        }
+        if (NumBits > 0)
+            Chars[c++] = Alphabet[(Bits << (6 - NumBits)) & 63];
+        Chars[c] = TEXT('\0');
+
+        return Str;
+    }
+
+    bool Decode(const FString& Str, TArray<uint8>& Bytes)
+    {
+        Bytes.Reset();
+
+        uint32 Bits = 0;
+        int32 NumBits = 0;
+        for (const TCHAR c : Str)
+        {
+            uint32 Value;
+            if (c >= 'A' && c <= 'Z') Value = c - 'A';
+            else if (c >= 'a' && c <= 'z') Value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') Value = c - '0' + 52;
+            else if (c == '-') Value = 62;
+            else if (c == '_') Value = 63;
+            else return false;
+
+            Bits = (Bits << 6) | Value;
+            NumBits += 6;
+            if (NumBits >= 8)
+            {
+                NumBits -= 8;
+                Bytes.Add(uint8(Bits >> NumBits));
+            }
+        }
+        return true;
+    }
+
+    void ToWords(const RenderStreamLink::FrameData& FrameData, uint32 (&Words)[FrameDataWords])
+    {
+        FMemory::Memcpy(Words, &FrameData, sizeof(Words));
+    }
 }
 
-bool FRenderStreamSyncFrameData::DeserializeFromString(const FString& Str)
+bool FRenderStreamSyncFrameData::IsDirty() const
+{
+    // Nothing is sent while d3 isn't providing frames and the followers already know it
+    return !m_handshakeSent || m_isQuitting || m_streamsChanged || m_frameDataValid != m_sentFrameDataValid || m_idle != m_sentIdle
+        || (m_frameDataValid && FMemory::Memcmp(&m_frameData, &m_sentFrameData, sizeof(RenderStreamLink::FrameData)) != 0);
+}
+
+FString FRenderStreamSyncFrameData::SerializeToString() const
 {
-    TArray<uint8> TempBytes;
-    TempBytes.AddUninitialized(Str.Len());
-    StringToBytes(Str, TempBytes.GetData(), Str.Len());
+    const bool bKeyframe = !m_handshakeSent || !m_sentFrameDataValid || ++m_framesSinceKeyframe >= KeyframeInterval;
+
+    uint8 Flags = 0;
+    Flags |= m_isQuitting ? PF_Quitting : 0;
+    Flags |= m_frameDataValid ? PF_FrameDataValid : 0;
+    Flags |= m_streamsChanged ? PF_StreamsChanged : 0;
+    Flags |= bKeyframe ? PF_Keyframe : 0;
+    Flags |= bKeyframe ? PF_Handshake : 0; // so a follower that joins late, or missed one, can still validate the controller
+    Flags |= m_frameDataValid && FRenderStreamFrameBundle::IsEnabled() ? PF_Bundle : 0;
+    Flags |= m_idle ? PF_Idle : 0;
 
-    FMemoryReader Ar(TempBytes);
-    if (Map(Ar))
+    m_payload.Reset();
+    FPayloadWriter Writer{ m_payload };
+    Writer.U8(Flags);
+    Writer.U8(++m_sequence);
+
+    if (Flags & PF_Handshake)
     {
-        FollowerReceive();
-        return true;
+        Writer.U16(RENDER_STREAM_VERSION_MAJOR);
+        Writer.U16(RENDER_STREAM_VERSION_MINOR);
+        Writer.U8(DATA_VERSION);
+        m_handshakeSent = true;
     }
 
-    return false;
+    if (m_frameDataValid)
+    {
+        uint32 Words[FrameDataWords], SentWords[FrameDataWords];
+        ToWords(m_frameData, Words);
+        ToWords(m_sentFrameData, SentWords);
+
+        uint16 Mask = 0;
+        for (int32 i = 0; i < FrameDataWords; ++i)
+        {
+            if (bKeyframe || Words[i] != SentWords[i])
+                Mask |= 1 << i;
+        }
+
+        Writer.U16(Mask);
+        for (int32 i = 0; i < FrameDataWords; ++i)
+        {
+            if (Mask & (1 << i))
+                Writer.U32(Words[i]);
+        }
+
+        m_sentFrameData = m_frameData;
+        if (bKeyframe)
+            m_framesSinceKeyframe = 0;
+    }
+    m_sentFrameDataValid = m_frameDataValid;
+    m_sentIdle = m_idle;
+
+    if (Flags & PF_Bundle)
+    {
+        FRenderStreamModule* Module = FRenderStreamModule::Get();
+        FFrameParameterBlock* Parameters = Module->m_sceneSelector ? &Module->m_sceneSelector->FrameParameters() : nullptr;
+        FMemoryWriter Ar(m_payload, /*bIsPersistent=*/ true, /*bSetOffset=*/ true);
+        const_cast<FRenderStreamSyncFrameData*>(this)->m_bundle.Serialize(Ar, Parameters);
+    }
+
+    // Reset flag after send
+    const_cast<FRenderStreamSyncFrameData*>(this)->m_streamsChanged = false;
+
+    return Encode(m_payload);
 }
 
-bool FRenderStreamSyncFrameData::Map(FArchive& Ar)
+bool FRenderStreamSyncFrameData::DeserializeFromString(const FString& Str)
 {
-    //Master is saving, slaves are loading
-    const bool bIsSaving = Ar.IsSaving();
+    FPayloadReader Reader{ m_payload };
+    if (!Decode(Str, m_payload))
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Malformed RenderStream sync payload from nDisplay controller"));
+        return false;
+    }
 
-    int rsMajorVersion = RENDER_STREAM_VERSION_MAJOR;
-    int rsMinorVersion = RENDER_STREAM_VERSION_MINOR;
-    static const int DATA_VERSION = 3;
-    int v = DATA_VERSION;
-    Ar << rsMajorVersion;
-    Ar << rsMinorVersion;
-    if (!bIsSaving)
+    const uint8 Flags = Reader.U8();
+    const uint8 Sequence = Reader.U8();
+
+    if (Flags & PF_Handshake)
     {
+        const uint16 rsMajorVersion = Reader.U16();
+        const uint16 rsMinorVersion = Reader.U16();
+        const uint8 v = Reader.U8();
         if (rsMajorVersion != RENDER_STREAM_VERSION_MAJOR ||
             rsMinorVersion != RENDER_STREAM_VERSION_MINOR)
         {
             UE_LOG(LogRenderStream, Error, TEXT("nDisplay master is running unsupported RenderStream library, expected version %i.%i, got version %i.%i"), RENDER_STREAM_VERSION_MAJOR, RENDER_STREAM_VERSION_MINOR, rsMajorVersion, rsMinorVersion);
+            m_handshakeReceived = false;
             return false;
         }
         if (v != DATA_VERSION)
         {
             UE_LOG(LogRenderStream, Error, TEXT("nDisplay master is running unsupported plugin, expected data version %i, got data version %i"), DATA_VERSION, v);
+            m_handshakeReceived = false;
             return false;
         }
+        m_handshakeReceived = true;
+    }
+    else if (!m_handshakeReceived)
+    {
+        // Joined after the last keyframe, or the controller is incompatible, which its handshake already logged
+        UE_LOG(LogRenderStream, Verbose, TEXT("RenderStream sync payload ignored until a keyframe's version handshake is accepted"));
+        return false;
+    }
+
+    // A gap in the sequence means the delta base is stale, frames are skipped until the next keyframe
+    if (!(Flags & PF_Keyframe) && Sequence != uint8(m_receivedSequence + 1) && m_deltaBaseValid)
+    {
+        UE_LOG(LogRenderStream, Warning, TEXT("RenderStream sync payload out of sequence, waiting for a keyframe"));
+        m_deltaBaseValid = false;
+    }
+    m_receivedSequence = Sequence;
+
+    bool bFrameDataValid = (Flags & PF_FrameDataValid) != 0;
+    if (bFrameDataValid)
+    {
+        uint32 Words[FrameDataWords];
+        ToWords(m_frameData, Words);
+
+        const uint16 Mask = Reader.U16();
+        for (int32 i = 0; i < FrameDataWords; ++i)
+        {
+            if (Mask & (1 << i))
+                Words[i] = Reader.U32();
+        }
+        FMemory::Memcpy(&m_frameData, Words, sizeof(Words));
+
+        if (Flags & PF_Keyframe)
+            m_deltaBaseValid = true;
+        if (!m_deltaBaseValid)
+            bFrameDataValid = false;
     }
-    Ar << m_isQuitting;
-    Ar << m_frameDataValid;
-    Ar.Serialize(&m_frameData, sizeof(RenderStreamLink::FrameData));
-    Ar << m_streamsChanged;
-    if (bIsSaving)
+
+    if (Reader.bOverrun)
+    {
+        UE_LOG(LogRenderStream, Error, TEXT("Truncated RenderStream sync payload from nDisplay controller"));
+        m_deltaBaseValid = false;
+        return false;
+    }
+
+    // Without a bundle the follower queries RenderStream itself
+    m_bundle.Reset();
+    if ((Flags & PF_Bundle) && bFrameDataValid)
     {
-        // Reset flag after send
-        m_streamsChanged = false;
+        FRenderStreamModule* Module = FRenderStreamModule::Get();
+        FFrameParameterBlock* Parameters = Module->m_sceneSelector ? &Module->m_sceneSelector->FrameParameters() : nullptr;
+        FMemoryReaderView Ar(MakeArrayView(m_payload).RightChop(Reader.Pos), /*bIsPersistent=*/ true);
+        m_bundle.Serialize(Ar, Parameters);
+        if (Ar.IsError())
+            UE_LOG(LogRenderStream, Warning, TEXT("Malformed frame bundle from nDisplay controller, querying RenderStream locally"));
     }
 
+    m_isQuitting = (Flags & PF_Quitting) != 0;
+    m_frameDataValid = bFrameDataValid;
+    m_streamsChanged = (Flags & PF_StreamsChanged) != 0;
+    m_idle = (Flags & PF_Idle) != 0;
+    FRenderStreamModule::Get()->SetIdle(m_idle);
+
+    FollowerReceive();
     return true;
 }
 
@@ -91,9 +325,37 @@ void FRenderStreamSyncFrameData::ControllerReceive()
     TRACE_CPUPROFILER_EVENT_SCOPE(TEXT("FRenderStreamSyncFrameData::ControllerReceive()"));
     SCOPE_CYCLE_COUNTER(STAT_AwaitFrame);
     const double StartTime = FPlatformTime::Seconds();
-    const RenderStreamLink::RS_ERROR Ret = RenderStreamLink::instance().rs_awaitFrameData(500, &m_frameData);
 
-    if (Ret == RenderStreamLink::RS_ERROR_STREAMS_CHANGED)
+    const ERenderStreamFrameAcquisition Policy = GetDefault<URenderStreamSettings>()->FrameAcquisition;
+    if (Policy != ERenderStreamFrameAcquisition::GameThread && !m_acquisition)
+        m_acquisition = MakeUnique<FRenderStreamFrameAcquisition>();
+
+    const int32 TimeoutMs = m_scheduler.NextTimeout(StartTime);
+    if (m_acquisition)
+        m_acquisition->SetAwaitTimeout(TimeoutMs);
+
+    // With an acquisition thread the frame stays held until it has been applied, RenderStream only keeps the data of
+    // the last awaited frame and Apply queries it. The scheduler is fed when the frame arrived, not when it was taken.
+    bool bHeld = false;
+    double ArrivalTime = 0.0;
+    auto Await = [this, &bHeld, &ArrivalTime, TimeoutMs]()
+    {
+        if (!m_acquisition)
+        {
+            const RenderStreamLink::RS_ERROR Result = RenderStreamLink::instance().rs_awaitFrameData(TimeoutMs, &m_frameData);
+            ArrivalTime = FPlatformTime::Seconds();
+            return Result;
+        }
+
+        if (bHeld)
+            m_acquisition->Release();
+        bHeld = true;
+        return m_acquisition->Take(m_frameData, ArrivalTime, TimeoutMs);
+    };
+
+    RenderStreamLink::RS_ERROR Ret = Await();
+    bool bIdle = false;
+    for (int32 Attempt = 1; Ret == RenderStreamLink::RS_ERROR_STREAMS_CHANGED; ++Attempt)
     {
         // Update the streams
         FRenderStreamModule* Module = FRenderStreamModule::Get();
@@ -101,8 +363,17 @@ void FRenderStreamSyncFrameData::ControllerReceive()
         Module->PopulateStreamPool();
         m_streamsChanged = true;
 
+        if (Attempt >= MaxStreamChangeAttempts)
+            break;
+
         // We need to actually get frame data, go back.
-        ControllerReceive();
+        Ret = Await();
+    }
+
+    if (Ret == RenderStreamLink::RS_ERROR_STREAMS_CHANGED)
+    {
+        UE_LOG(LogRenderStream, Warning, TEXT("Streams changed %d times in a row, skipping frame"), MaxStreamChangeAttempts);
+        m_frameDataValid = false;
     }
     else if (Ret == RenderStreamLink::RS_ERROR_QUIT)
     {
@@ -114,13 +385,17 @@ void FRenderStreamSyncFrameData::ControllerReceive()
     {
         if (Ret == RenderStreamLink::RS_ERROR_TIMEOUT)
         {
-            RenderStreamLink::instance().rs_setNewStatusMessage("Not requested");
+            // Timeouts are short while d3 is requesting, only report it once the requests have actually stopped
+            m_scheduler.OnMissed();
+            bIdle = m_scheduler.IsIdle(FPlatformTime::Seconds());
+            if (bIdle)
+                RenderStreamLink::instance().rs_setNewStatusMessage("Not requested");
         }
         else
         {
             UE_LOG(LogRenderStream, Error, TEXT("Error awaiting frame data error %d"), Ret);
         }
-        m_frameDataValid = false; // TODO: Mark timecode as invalid only after some multiple of the expected incoming framerate.
+        m_frameDataValid = false;
     }
     else
     {
@@ -128,32 +403,47 @@ void FRenderStreamSyncFrameData::ControllerReceive()
         {
             RenderStreamLink::instance().rs_setNewStatusMessage("");
         }
+        m_scheduler.OnFrame(m_frameData, ArrivalTime);
 
-        // Force a fixed time-step on the controller, followers will sync it via nDisplay
-        float DeltaSeconds;
+        // The controller's time step follows d3, followers will sync it via nDisplay
         if (FMath::IsNaN(LastTrackedTime))
-            DeltaSeconds = static_cast<float>(m_frameData.frameRateDenominator) / m_frameData.frameRateNumerator;
+            DeltaSeconds = static_cast<double>(m_frameData.frameRateDenominator) / m_frameData.frameRateNumerator;
         else
             DeltaSeconds = m_frameData.tTracked - LastTrackedTime;
 
-        if (DeltaSeconds <= 0.f)
+        if (DeltaSeconds <= 0.0)
         {
             UE_LOG(LogRenderStream, Error, TEXT("Negative delta time! tTracked: %f LastTrackedTime: %f"), m_frameData.tTracked, LastTrackedTime);
-            DeltaSeconds = static_cast<float>(m_frameData.frameRateDenominator) / m_frameData.frameRateNumerator;
+            DeltaSeconds = static_cast<double>(m_frameData.frameRateDenominator) / m_frameData.frameRateNumerator;
         }
 
         LastTrackedTime = m_frameData.tTracked;
 
-        FApp::SetUseFixedTimeStep(true);
-        FApp::SetFixedDeltaTime(DeltaSeconds);
+        // Without URenderStreamCustomTimeStep, force a fixed time-step instead
+        if (!URenderStreamCustomTimeStep::IsActive())
+        {
+            FApp::SetUseFixedTimeStep(true);
+            FApp::SetFixedDeltaTime(DeltaSeconds);
+        }
 
         m_frameDataValid = true;
         Apply();
     }
 
+    if (bHeld)
+        m_acquisition->Release();
+
+    m_idle = bIdle && GetDefault<URenderStreamSettings>()->IdleWhenNotRequested;
+    FRenderStreamModule::Get()->SetIdle(m_idle);
+
     AwaitTime = (FPlatformTime::Seconds() - StartTime) * 1000.f;
 }
 
+void FRenderStreamSyncFrameData::StopAcquisition()
+{
+    m_acquisition.Reset();
+}
+
 void FRenderStreamSyncFrameData::FollowerReceive() const
 {
     TRACE_CPUPROFILER_EVENT_SCOPE(TEXT("FRenderStreamSyncFrameData::FollowerReceive()"));
@@ -168,28 +458,31 @@ void FRenderStreamSyncFrameData::FollowerReceive() const
 
 void FRenderStreamSyncFrameData::FollowerReceive(bool streamsChanged, bool shouldQuit) const
 {
-    if (streamsChanged)
+    for (int32 Attempt = 0; Attempt < MaxStreamChangeAttempts; ++Attempt)
     {
-        // Update the streams
-        FRenderStreamModule* Module = FRenderStreamModule::Get();
-        check(Module);
-        IDisplayClusterClusterManager* ClusterMgr = IDisplayCluster::IsAvailable() ? IDisplayCluster::Get().GetClusterMgr() : nullptr;
-        const bool IsController = !ClusterMgr || ClusterMgr->IsPrimary();
-        Module->PopulateStreamPool();
-    }
+        if (streamsChanged)
+        {
+            // Update the streams
+            FRenderStreamModule* Module = FRenderStreamModule::Get();
+            check(Module);
+            Module->PopulateStreamPool();
+            streamsChanged = false;
+        }
 
-    if (shouldQuit)
-    {
-        // get the quit status direct from RenderStream, so it can notify everyone that we heard.
-        while (RenderStreamLink::instance().rs_beginFollowerFrame(DBL_MAX) != RenderStreamLink::RS_ERROR_QUIT)
+        if (shouldQuit)
         {
-            UE_LOG(LogRenderStream, Warning, TEXT("Waiting for quit status from RenderStream"));
+            // get the quit status direct from RenderStream, so it can notify everyone that we heard.
+            while (RenderStreamLink::instance().rs_beginFollowerFrame(DBL_MAX) != RenderStreamLink::RS_ERROR_QUIT)
+            {
+                UE_LOG(LogRenderStream, Warning, TEXT("Waiting for quit status from RenderStream"));
+            }
+            QuitNow();
+            return;
         }
-        QuitNow();
-        return;
-    }
-    else if (m_frameDataValid)
-    {
+
+        if (!m_frameDataValid)
+            return;
+
         // We have been given the frameData the controller node is using for this synchronised frame.
         // We must now let RenderStream know this is the frame we are processing, so that RS APIs give the correct data.
         RenderStreamLink::RS_ERROR err = RenderStreamLink::instance().rs_beginFollowerFrame(m_frameData.tTracked);
@@ -201,19 +494,16 @@ void FRenderStreamSyncFrameData::FollowerReceive(bool streamsChanged, bool shoul
 
         if (err == RenderStreamLink::RS_ERROR_STREAMS_CHANGED)
         {
-            FollowerReceive(true, shouldQuit);
-            return;
-        }
-
-        if (err == RenderStreamLink::RS_ERROR_QUIT)
-        {
-            FollowerReceive(streamsChanged, true);
-            return;
+            streamsChanged = true;
+            continue;
         }
 
         // Write into the engine for this node.
         Apply();
+        return;
     }
+
+    UE_LOG(LogRenderStream, Warning, TEXT("Streams changed %d times in a row, skipping frame"), MaxStreamChangeAttempts);
 }
 
 void FRenderStreamSyncFrameData::Apply() const
@@ -222,6 +512,11 @@ void FRenderStreamSyncFrameData::Apply() const
     FRenderStreamModule* Module = FRenderStreamModule::Get();
     Module->ApplyScene(m_frameData.scene);
     Module->ApplyCameras(m_frameData);
+
+    // The rate that d3 is sending new time values. Each new localtime value is in 1/render rate increments
+    const FFrameRate d3RenderRate(m_frameData.frameRateNumerator, m_frameData.frameRateDenominator);
+    const FTimecode timecode(m_frameData.localTime, d3RenderRate, false);
+    FrameTime = FQualifiedFrameTime(timecode, d3RenderRate);
 }
 
 void FRenderStreamSyncFrameData::QuitNow() const
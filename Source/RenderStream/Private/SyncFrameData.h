@@ -1,7 +1,11 @@
 #pragma once
 
 #include "Cluster/IDisplayClusterClusterSyncObject.h"
+#include "Misc/QualifiedFrameTime.h"
 #include "RenderStreamLink.h"
+#include "RenderStreamFrameBundle.h"
+#include "RenderStreamFrameAcquisition.h"
+#include "RenderStreamAwaitScheduler.h"
 
 class FRenderStreamSyncFrameData : public IDisplayClusterClusterSyncObject
 {
@@ -9,14 +13,13 @@ public:
     /** IDisplayClusterClusterSyncObject implementation */
     virtual bool IsActive() const override;
     virtual FString GetSyncId() const override;
-    virtual bool IsDirty() const override { return true; };
+    virtual bool IsDirty() const override;
     virtual void ClearDirty() override {};
     virtual FString SerializeToString() const override;
     virtual bool DeserializeFromString(const FString& Ar) override;
 
-    bool Map(FArchive& Ar);
-
     void ControllerReceive();     // Controller receives from RenderStream, calls Apply.
+    void StopAcquisition();       // Stops the frame acquisition thread, if one was started.
 
 protected:
     void FollowerReceive() const; // Follower receives from master, validates with RenderStream, calls Apply.
@@ -24,12 +27,35 @@ protected:
     void Apply() const;           // Applies changes from RS API to the engine, locally.
     void QuitNow() const;         // Exit the application due to a RenderStream-requested quit.
 
+    // Controller side of the payload encoding: what the followers were last sent.
+    mutable RenderStreamLink::FrameData m_sentFrameData = {};
+    mutable bool m_sentFrameDataValid = false;
+    mutable bool m_sentIdle = false;
+    mutable bool m_handshakeSent = false;
+    mutable uint8 m_sequence = 0;
+    mutable int32 m_framesSinceKeyframe = 0;
+
+    mutable TArray<uint8> m_payload; // reused by both sides for the decoded bytes
+
+    // Follower side: the handshake has been validated and the sequence of the last payload applied.
+    bool m_handshakeReceived = false;
+    bool m_deltaBaseValid = false;
+    uint8 m_receivedSequence = 0;
+
+    // Controller side, when FrameAcquisition is not GameThread. Created on the first ControllerReceive.
+    TUniquePtr<FRenderStreamFrameAcquisition> m_acquisition;
+
 public:
     bool m_isQuitting = false;
     bool m_frameDataValid = false;
     RenderStreamLink::FrameData m_frameData;
     bool m_streamsChanged = false;
+    bool m_idle = false; // d3 is not requesting frames, decided by the controller
     double LastTrackedTime = std::numeric_limits<double>::quiet_NaN();
     double AwaitTime = 0;
+    double DeltaSeconds = 0; // controller: tTracked delta of the last frame received
+    mutable FQualifiedFrameTime FrameTime; // localTime of the last frame applied, at d3's frame rate
     mutable double ReceiveTime = 0;
+    FRenderStreamFrameBundle m_bundle;
+    FRenderStreamAwaitScheduler m_scheduler; // controller only
 };
@@ -5,9 +5,48 @@
 #include "RHI.h"
 #include "RHIResources.h"
 
+#include <atomic>
+
 class FRHICommandListImmediate;
 
-class FFrameStream
+// What FFrameStream::Update changed, so callers only redo the work that depends on it.
+enum class EStreamChange : uint8
+{
+    None = 0,
+    Handle = 1 << 0,
+    Clipping = 1 << 1,
+    Channel = 1 << 2,
+    Resources = 1 << 3, // resolution or format changed, the shared texture was recreated
+    Failed = 1 << 4, // the shared texture couldn't be recreated, the stream kept its previous state and can't be sent
+};
+ENUM_CLASS_FLAGS(EStreamChange);
+
+// What d3 describes a stream as. Immutable once published, FFrameStream::Update publishes a new one, so the rendering
+// thread never sees a stream change under it. A replaced state lives on in the pool snapshots that referenced it, which
+// are kept for the frames in flight.
+struct FFrameStreamState
+{
+    FString Channel;
+    RenderStreamLink::ProjectionClipping Clipping = {};
+    FIntPoint Resolution = FIntPoint::ZeroValue;
+    RenderStreamLink::RSPixelFormat Format = RenderStreamLink::RS_FMT_INVALID;
+    RenderStreamLink::StreamHandle Handle = 0;
+};
+using FFrameStreamStatePtr = TSharedPtr<const FFrameStreamState, ESPMode::ThreadSafe>;
+
+// Draw state a stream's blit keeps between frames, see RSUCHelpers::BlitFrame. Rendering thread.
+struct FStreamBlitState
+{
+    FGraphicsPipelineStateInitializer PipelineState;
+    bool bPipelineStateValid = false;
+    FUniformBufferRHIRef Parameters;
+    FTextureRHIRef ParametersSource; // the texture Parameters sample
+    FBufferRHIRef VertexBuffer;
+    FVector4f VertexUVs; // left, right, top, bottom
+};
+
+// Always created shared, the render commands it queues keep it alive.
+class FFrameStream : public TSharedFromThis<FFrameStream, ESPMode::ThreadSafe>
 {
 public:
     FFrameStream();
@@ -16,22 +55,61 @@ public:
     void SendFrame_RenderingThread(FRHICommandListImmediate & RHICmdList, 
                                    RenderStreamLink::CameraResponseData& FrameData,
                                    FRHITexture* InSourceTexture,
-                                   const FIntRect& ViewportRect);
+                                   const FIntRect& ViewportRect,
+                                   const RenderStreamLink::ProjectionClipping& Crop = { 0.f, 1.f, 0.f, 1.f }); // normalised part of ViewportRect to send
+    // Sends what Source sent this frame under this stream's handle, for streams whose output is identical to Source's.
+    void SendDuplicate_RenderingThread(FRHICommandListImmediate& RHICmdList,
+                                       RenderStreamLink::CameraResponseData& FrameData,
+                                       const FFrameStream& Source);
 
     bool Setup(const FString& Name, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt);
-    void Update(const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt);
+    EStreamChange Update(const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt);
+    // Stops sending, the stream's resources are released once the pool drops it.
+    void Retire();
+
+    // The published state, any thread. Game thread callers see their own Update immediately.
+    const FFrameStreamState& State() const { return *m_state.load(std::memory_order_acquire); }
+    // Game thread, for the pool snapshot to keep the state alive while the rendering thread may be using it.
+    const FFrameStreamStatePtr& SharedState() const { return m_stateOwner; }
 
     const FString& Name() const { return m_streamName;}
-    const FString& Channel() const { return m_channel; }
-    const RenderStreamLink::ProjectionClipping& Clipping() const { return m_clipping; }
-    FIntPoint Resolution() const { return m_resolution; }
-    RenderStreamLink::StreamHandle Handle() const { return m_handle; }
+    const FString& Channel() const { return State().Channel; }
+    const RenderStreamLink::ProjectionClipping& Clipping() const { return State().Clipping; }
+    FIntPoint Resolution() const { return State().Resolution; }
+    RenderStreamLink::RSPixelFormat Format() const { return State().Format; }
+    RenderStreamLink::StreamHandle Handle() const { return State().Handle; }
+
+    // FRenderStreamViewportHandle of the viewport rendering this stream, INDEX_NONE until the stream is configured.
+    int32 ViewportHandle() const { return m_viewportHandle; }
+    void SetViewportHandle(int32 Handle) { m_viewportHandle = Handle; }
+
+    // The camera view this stream is a fragment of, streams of the same view and channel differ only in their clipping.
+    uint64 MappingId() const { return m_mappingId; }
+    int32 Viewpoint() const { return m_viewpoint; }
+    void SetView(uint64 MappingId, int32 Viewpoint) { m_mappingId = MappingId; m_viewpoint = Viewpoint; }
 
 private:
+    // One of the textures frames are sent from, see URenderStreamSettings::StreamOutputBuffers
+    struct FOutputBuffer
+    {
+        FTextureRHIRef Texture;
+        FGPUFenceRHIRef Fence; // written once d3 has been handed the frame in Texture, see FRenderStreamFrameSubmission
+        RenderStreamLink::RSPixelFormat Format = RenderStreamLink::RS_FMT_INVALID; // what Texture is sent as, may be a fallback for the stream's
+        bool bInvertAlpha = false;
+        bool bInFlight = false;
+    };
+
+    void SetState(FFrameStreamStatePtr State);
+    bool CreateOutputs(const FFrameStreamState& State);
+
     FString m_streamName;
-    FString m_channel;
-    RenderStreamLink::ProjectionClipping m_clipping;
-    FTextureRHIRef m_bufTexture;
-    FIntPoint m_resolution;
-    RenderStreamLink::StreamHandle m_handle;
+    FFrameStreamStatePtr m_stateOwner; // game thread
+    std::atomic<const FFrameStreamState*> m_state;
+    TArray<FOutputBuffer> m_outputs; // rendering thread
+    int32 m_output; // the buffer last sent
+    int32 m_numOutputs; // game thread's count of m_outputs
+    FStreamBlitState m_blit; // rendering thread
+    int32 m_viewportHandle;
+    uint64 m_mappingId;
+    int32 m_viewpoint;
 };
\ No newline at end of file
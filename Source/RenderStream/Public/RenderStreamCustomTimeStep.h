@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Engine/EngineCustomTimeStep.h"
+#include "Misc/QualifiedFrameTime.h"
+
+#include "RenderStreamCustomTimeStep.generated.h"
+
+/**
+ * Paces the engine from RenderStream.
+ *
+ * On the nDisplay controller every engine frame waits for d3 to request a frame, then advances the engine clock by the
+ * tTracked delta of that request, so the game thread neither sleeps nor idles on top of the wait. Followers are paced by
+ * the nDisplay sync and take the controller's time. Installed automatically when URenderStreamSettings::DriveEngineTimeStep
+ * is set and the project doesn't use another custom time step.
+ */
+UCLASS(EditInlineNew, Blueprintable)
+class RENDERSTREAM_API URenderStreamCustomTimeStep : public UEngineCustomTimeStep
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+	//~ UEngineCustomTimeStep interface
+	virtual bool Initialize(class UEngine* InEngine) override;
+	virtual void Shutdown(class UEngine* InEngine) override;
+	virtual bool UpdateTimeStep(class UEngine* InEngine) override;
+	virtual ECustomTimeStepSynchronizationState GetSynchronizationState() const override;
+
+	/** The time of the last frame received from RenderStream, at d3's frame rate. */
+	FQualifiedFrameTime GetQualifiedFrameTime() const;
+
+	/** The engine is being paced by a URenderStreamCustomTimeStep. */
+	static bool IsActive();
+};
@@ -579,6 +579,7 @@ public: // d3renderstream.h API, but loaded dynamically.
 
 private:
     bool m_loaded = false;
+    bool m_inProcess = false; // rs_* bound to an in-process provider (see RenderStreamLoopback.h) rather than the DLL
     void* m_dll = nullptr;
 };
 
@@ -1,38 +1,75 @@
 #pragma once
 
-#include "Engine/Console.h" 
+#include "Engine/Console.h"
+#include "HAL/Runnable.h"
 #include "RenderStreamLink.h"
 
-class FRenderStreamLogOutputDevice : public FOutputDevice
+#include <atomic>
+
+class FEvent;
+class FRunnableThread;
+
+// Forwards engine log lines to d3.
+//
+// Serialize only filters the line and copies it into a fixed-size slot of a bounded lock-free ring, so logging threads
+// never call into the RenderStream DLL. A background thread drains the ring, joins lines into batches and forwards them
+// with rs_logToD3, limited to a maximum number of lines per second. Lines that do not fit in the ring or exceed the rate
+// limit are dropped and reported to d3 as a count. Filters are read from URenderStreamSettings when the device is created.
+class FRenderStreamLogOutputDevice : public FOutputDevice, public FRunnable
 {
 public:
-    FRenderStreamLogOutputDevice()
-    {
-        check(GLog);
-        GLog->AddOutputDevice(this);
-    }
+    FRenderStreamLogOutputDevice();
+    ~FRenderStreamLogOutputDevice();
 
-    ~FRenderStreamLogOutputDevice()
-    {
-        if (GLog != nullptr)
-        {
-            GLog->RemoveOutputDevice(this);
-        }
-    }
+    virtual bool CanBeUsedOnAnyThread() const override { return true; }
+    virtual bool CanBeUsedOnMultipleThreads() const override { return true; }
+    virtual void Flush() override;
 
 protected:
-    void Serialize(const TCHAR* Message, ELogVerbosity::Type Verbosity, const class FName& Category) override
-    {
-        if (RenderStreamLink::instance().isAvailable())
-        {
-            FString s;
-            s += Category.ToString();
-            s += ": ";
-            s += Message;
-            RenderStreamLink::instance().rs_logToD3(TCHAR_TO_ANSI(*s));
-        }
-    }
+    void Serialize(const TCHAR* Message, ELogVerbosity::Type Verbosity, const class FName& Category) override;
 
 private:
+    static constexpr uint32 RingSize = 1024; // must be a power of two
+    static constexpr int32 MaxLineLength = 512;
+    static constexpr int32 MaxBatchLength = 8192;
+
+    struct FSlot
+    {
+        std::atomic<uint32> Sequence;
+        FName Category;
+        int32 Length;
+        char Text[MaxLineLength];
+    };
+
+    virtual uint32 Run() override;
+    virtual void Stop() override;
+
+    bool Accepts(ELogVerbosity::Type Verbosity, const FName& Category) const;
+    bool Enqueue(const TCHAR* Message, const FName& Category);
+    void Drain(bool bIgnoreRateLimit);
+    void SendBatch();
+    void AppendToBatch(const char* Text, int32 Length);
+
+    // Filters, fixed for the lifetime of the device
+    ELogVerbosity::Type m_maxVerbosity = ELogVerbosity::Log;
+    TArray<FName> m_includeCategories;
+    TArray<FName> m_excludeCategories;
+    int32 m_maxLinesPerSecond = 0;
+
+    // Vyukov bounded MPSC queue: producers claim slots with a CAS on m_enqueuePos, the drain thread is the only consumer
+    FSlot* m_ring = nullptr;
+    alignas(64) std::atomic<uint32> m_enqueuePos{ 0 };
+    alignas(64) uint32 m_dequeuePos = 0;
+    std::atomic<uint32> m_droppedFull{ 0 };
+
+    // Drain thread state
+    FCriticalSection m_drainLock; // serialises Drain between the drain thread and Flush
+    TArray<char> m_batch;
+    uint32 m_droppedRate = 0;
+    double m_rateWindowStart = 0.0;
+    int32 m_rateWindowLines = 0;
 
-};
\ No newline at end of file
+    FRunnableThread* m_thread = nullptr;
+    FEvent* m_wake = nullptr;
+    std::atomic<bool> m_stop{ false };
+};
@@ -42,9 +42,13 @@ public:
     {
         return Parameters;
     }
+
+    // FRenderStreamViewportHandle of the viewport using this policy, INDEX_NONE before the scene starts.
+    int32 GetViewportHandle() const { return ViewportHandle; }
     
 protected:
     FString ProjectionPolicyId;
+    int32 ViewportHandle;
     TMap<FString, FString> Parameters;
     
     float NCP;
@@ -1,11 +1,73 @@
 #pragma once
 
 #include "RenderStreamLink.h"
+#include <string>
 #include <vector>
 
 class UWorld;
 class AActor;
 
+// Every value of one scene for the current frame. Fetch pulls floats, image descriptors, text pointers and skeleton poses
+// in a single pass, so the property appliers only read from here instead of calling into RenderStream per property.
+// Storage is laid out once per scene and reused frame to frame.
+class FFrameParameterBlock
+{
+public:
+    struct FPose
+    {
+        RenderStreamLink::RS_ERROR Result = RenderStreamLink::RS_ERROR_SUCCESS;
+        int32 NumJoints = 0; // 0 with a successful result means no skeleton is assigned
+        RenderStreamLink::SkeletonPose Pose{};
+        TArray<RenderStreamLink::SkeletonJointPose> Joints;
+    };
+
+    // Read position of the appliers, carried across the actors of a scene.
+    struct FCursor
+    {
+        size_t Param = 0;
+        size_t Float = 0;
+        size_t Image = 0;
+        size_t Text = 0;
+        size_t Pose = 0;
+    };
+
+    bool Fetch(const RenderStreamLink::RemoteParameters& Scene);
+
+    // Frame bundle transport. Saving writes the values of the last successful Fetch, if any were fetched since the previous
+    // save. Loading installs the controller's values, which the next Fetch for the same scene returns without calling d3.
+    void SerializeBundle(FArchive& Ar);
+
+    uint64_t Hash() const { return m_hash; }
+    const float* Floats() const { return reinterpret_cast<const float*>(Bytes()); }
+    size_t NumFloats() const { return m_numFloats; }
+    const RenderStreamLink::ImageFrameData* Images() const { return reinterpret_cast<const RenderStreamLink::ImageFrameData*>(Bytes() + m_imageOffset); }
+    size_t NumImages() const { return m_numImages; }
+    // Pointers are owned by RenderStream and stay valid until the next rs_awaitFrameData, null if the fetch failed.
+    // Values loaded from a frame bundle point into the block and stay valid until the next load.
+    const char* const* Texts() const { return reinterpret_cast<const char* const*>(Bytes() + m_textOffset); }
+    size_t NumTexts() const { return m_numTexts; }
+    const TArray<FPose>& Poses() const { return m_poses; }
+
+private:
+    bool Layout(const RenderStreamLink::RemoteParameters& Scene);
+    void Layout(uint64_t Hash, size_t NumFloats, size_t NumImages, size_t NumTexts, size_t NumPoses);
+    uint8_t* Bytes() const { return reinterpret_cast<uint8_t*>(const_cast<uint64_t*>(m_values.data())); }
+    void FetchPose(uint32_t iPose, FPose& Pose) const;
+
+    uint64_t m_hash = 0;
+    bool m_laidOut = false;
+    bool m_fetched = false;     // fetched from d3 since the last bundle save
+    bool m_distributed = false; // loaded from a bundle and not yet returned by Fetch
+    size_t m_numFloats = 0;
+    size_t m_numImages = 0;
+    size_t m_numTexts = 0;
+    size_t m_imageOffset = 0; // bytes
+    size_t m_textOffset = 0;  // bytes
+    std::vector<uint64_t> m_values; // floats | image descriptors | text pointers, 8 byte aligned
+    TArray<FPose> m_poses;
+    std::vector<char> m_textStorage; // text values loaded from a bundle
+};
+
 // Select a scene within the project, provide and apply parameters.
 class RenderStreamSceneSelector
 {
@@ -23,6 +85,8 @@ public:
 
     SchemaStatus SchemaStatus() const;
 
+    FFrameParameterBlock& FrameParameters() { return m_frameParameters; }
+
 protected:
     const RenderStreamLink::Schema& Schema() const;
     void GetAllLevels(TArray<AActor*>& Actors, ULevel* Level) const;
@@ -32,11 +96,19 @@ protected:
     void ApplyParameters(uint32_t sceneId, const TArray<AActor*>& Actors);
 private:
     size_t ValidateParameters(const AActor* Root, RenderStreamLink::RemoteParameter* const parameters, size_t numParameters) const;
-    void ApplyParameters(AActor* Root, uint64_t specHash, const RenderStreamLink::RemoteParameter** ppParams, const size_t nParams, const float** ppFloatValues, const size_t nFloatVals, const RenderStreamLink::ImageFrameData** ppImageValues, const size_t nImageVals);
-    void ApplySkeletalPose(uint64_t specHash, size_t iPose, const FString& ParamKey, RenderStreamLink::FAnimDataKey& PropKey);
+    void ApplyParameters(AActor* Root, const RenderStreamLink::RemoteParameters& params, FFrameParameterBlock::FCursor& cursor);
+    void ApplySkeletalPose(uint64_t specHash, size_t iPose, const FName& ParamKey, RenderStreamLink::FAnimDataKey& PropKey);
     
     TMap<uint64_t /*id*/, RenderStreamLink::FSkeletalLayout> m_skeletalLayoutCache;
     std::vector<uint8_t> m_schemaMem;
     RenderStreamLink::ScopedSchema m_defaultSchema;
+    FFrameParameterBlock m_frameParameters;
     std::vector<float> m_floatValuesLast;
+    struct FTextValueLast
+    {
+        TWeakObjectPtr<AActor> Actor;
+        std::string Value;
+    };
+    std::vector<FTextValueLast> m_textValuesLast; // text properties are only rebuilt when their value or actor changes
+    RenderStreamLink::FSkeletalPose m_poseScratch;
 };
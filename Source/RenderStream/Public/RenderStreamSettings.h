@@ -25,6 +25,39 @@ enum class ERenderStreamSceneSelector
     // RenderStream will load maps, without changing any sub-level visibility settings.
     Maps                UMETA(DisplayName = "Maps"),
 };
+
+UENUM()
+enum class ERenderStreamLogVerbosity : uint8
+{
+    Fatal               UMETA(DisplayName = "Fatal"),
+    Error               UMETA(DisplayName = "Error"),
+    Warning             UMETA(DisplayName = "Warning"),
+    Display             UMETA(DisplayName = "Display"),
+    Log                 UMETA(DisplayName = "Log"),
+    Verbose             UMETA(DisplayName = "Verbose"),
+    VeryVerbose         UMETA(DisplayName = "Very verbose"),
+};
+
+UENUM()
+enum class ERenderStreamFrameAcquisition : uint8
+{
+    // The game thread waits for every frame itself.
+    GameThread          UMETA(DisplayName = "Game thread"),
+    // A background thread waits for the next frame while the current one is simulated; every frame is applied in order.
+    StrictOrder         UMETA(DisplayName = "Background thread"),
+};
+
+UENUM()
+enum class ERenderStreamCameraPrediction : uint8
+{
+    // Tracked cameras are rendered from the pose received.
+    None                    UMETA(DisplayName = "None"),
+    // Extrapolate from the velocity over the last two poses.
+    ConstantVelocity        UMETA(DisplayName = "Constant velocity"),
+    // Extrapolate from the velocity and acceleration over the last three poses.
+    ConstantAcceleration    UMETA(DisplayName = "Constant acceleration"),
+};
+
 /**
 * Implements the settings for the RenderStream plugin.
 */
@@ -42,4 +75,104 @@ public:
 
     UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Detect and control custom events")
     bool GenerateEvents;
+
+    // The nDisplay controller reads parameters and cameras from RenderStream once per frame and sends them to the
+    // followers with the cluster sync data, instead of every node querying RenderStream itself.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Distribute frame data from the nDisplay controller")
+    bool DistributeFrameBundle;
+
+    // Where the nDisplay controller waits for frames from d3. Waiting on a background thread overlaps the wait with the
+    // rest of the game thread's frame.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Frame acquisition")
+    ERenderStreamFrameAcquisition FrameAcquisition;
+
+    // While d3 is not requesting frames the cluster skips rendering and waits for the next request instead.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Skip rendering while not requested")
+    bool IdleWhenNotRequested;
+
+    // Installs URenderStreamCustomTimeStep, unless the project already uses a custom time step, so the engine clock follows d3.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Pace the engine from RenderStream")
+    bool DriveEngineTimeStep;
+
+    // Viewports whose stream d3 didn't request in the current frame are neither rendered nor sent.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Only render requested streams")
+    bool RenderOnDemand;
+
+    // Streams that are fragments of the same camera view and channel are rendered once, as the union of their clipping,
+    // and each is sent as a crop of it. Saves a scene render per fragment on nodes serving tiled LED walls.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Render fragments of a view once")
+    bool RenderFragmentsOnce;
+
+    // Streams of the same mapping and viewpoint with the same channel, clipping, resolution and format are rendered and
+    // blitted once, and the result is sent under each stream's handle. Stops redundant outputs, such as those for backup
+    // servers, doubling GPU cost. Identical streams of different mappings are still rendered separately.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Render duplicate streams once")
+    bool DeduplicateStreams;
+
+    // Textures each stream sends from in turn. With more than one, a frame is written while the previous ones are still
+    // being read and sending doesn't wait for the RHI thread. 1 flushes before every send. Always 1 on Vulkan, where d3
+    // doesn't signal when it has read a texture.
+    UPROPERTY(EditAnywhere, config, Category = Settings, DisplayName="Output buffers per stream", meta = (ClampMin = "1", ClampMax = "4"))
+    int32 StreamOutputBuffers;
+
+    // Extrapolates tracked camera poses to when the frame is displayed, hiding tracking latency in AR and xR.
+    UPROPERTY(EditAnywhere, config, Category = "Camera Prediction", DisplayName = "Prediction")
+    ERenderStreamCameraPrediction CameraPrediction;
+
+    // How far past the tracked time poses are extrapolated, usually the frames between tracking and display.
+    UPROPERTY(EditAnywhere, config, Category = "Camera Prediction", DisplayName = "Horizon (ms)", meta = (ClampMin = "0", ClampMax = "200"))
+    float CameraPredictionHorizon;
+
+    // Camera movement faster than this is treated as a cut or a tracking glitch and is not extrapolated. 0 disables the limit.
+    UPROPERTY(EditAnywhere, config, Category = "Camera Prediction", DisplayName = "Max speed (m/s)", meta = (ClampMin = "0"))
+    float CameraPredictionMaxSpeed;
+
+    // Camera rotation faster than this is treated as a cut or a tracking glitch and is not extrapolated. 0 disables the limit.
+    UPROPERTY(EditAnywhere, config, Category = "Camera Prediction", DisplayName = "Max angular speed (deg/s)", meta = (ClampMin = "0"))
+    float CameraPredictionMaxAngularSpeed;
+
+    // Least severe verbosity forwarded to the d3 log.
+    UPROPERTY(EditAnywhere, config, Category = "Log Forwarding", DisplayName = "Forwarded verbosity")
+    ERenderStreamLogVerbosity LogForwardingVerbosity;
+
+    // When not empty, only these log categories are forwarded to d3.
+    UPROPERTY(EditAnywhere, config, Category = "Log Forwarding", DisplayName = "Include categories")
+    TArray<FName> LogForwardingIncludeCategories;
+
+    // Log categories that are never forwarded to d3.
+    UPROPERTY(EditAnywhere, config, Category = "Log Forwarding", DisplayName = "Exclude categories")
+    TArray<FName> LogForwardingExcludeCategories;
+
+    // Lines forwarded to d3 per second, further lines are dropped and counted. 0 forwards everything.
+    UPROPERTY(EditAnywhere, config, Category = "Log Forwarding", DisplayName = "Max lines per second", meta = (ClampMin = "0"))
+    int32 LogForwardingMaxLinesPerSecond;
+
+    // Frames each sent metric is aggregated over. With 1, the value of the last frame is sent as is.
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Window frames", meta = (ClampMin = "1", ClampMax = "600"))
+    int32 TelemetryWindowFrames;
+
+    // Metrics are sent to d3 once every this many frames.
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Send interval (frames)", meta = (ClampMin = "1", ClampMax = "600"))
+    int32 TelemetrySendInterval;
+
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Send minimum")
+    bool TelemetrySendMin;
+
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Send average")
+    bool TelemetrySendAvg;
+
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Send maximum")
+    bool TelemetrySendMax;
+
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Send 99th percentile")
+    bool TelemetrySendP99;
+
+    // When not empty, only these metrics are sent to d3, e.g. "Frame Time" or "GPU Time".
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Sent metrics")
+    TArray<FString> TelemetryMetrics;
+
+    // Cycle and counter stats from the engine stats system forwarded as metrics, by short name, e.g. STAT_AwaitFrame or
+    // STAT_FrameLoopAllocations. Requires a STATS build.
+    UPROPERTY(EditAnywhere, config, Category = Telemetry, DisplayName = "Forwarded stats")
+    TArray<FName> TelemetryStats;
 };
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderStreamLink.h"
+
+#include <atomic>
+#include <string>
+
+class URenderStreamSettings;
+
+// Handle to a metric registered with FRenderStreamTelemetry. Cheap to copy and to record through.
+struct RENDERSTREAM_API FRenderStreamMetric
+{
+    int32 Index = INDEX_NONE;
+
+    bool IsValid() const { return Index != INDEX_NONE; }
+};
+
+// Collects per-frame metrics and forwards them to d3 with rs_sendProfilingData.
+//
+// Metrics are registered once by name, by RenderStream or by project code, and recorded through the returned handle.
+// Recording stores the value in a preallocated slot; the last value recorded in a frame wins. At the end of every frame
+// the recorded values are pushed into a per-metric window, and every TelemetrySendInterval frames the window is reduced
+// to min/avg/max/p99 and sent. Which metrics are sent, the window length and the aggregates are read from
+// URenderStreamSettings.
+class RENDERSTREAM_API FRenderStreamTelemetry
+{
+public:
+    static constexpr int32 MaxMetrics = 256;
+
+    static FRenderStreamTelemetry& Get();
+
+    // Returns the existing handle if Name is already registered, or an invalid handle once MaxMetrics is reached.
+    FRenderStreamMetric RegisterMetric(const FString& Name);
+
+    // Thread safe, never allocates.
+    void Record(FRenderStreamMetric Metric, float Value);
+
+    // Reads the window, send interval, aggregates and metric filter from the settings. Game thread.
+    void Configure(const URenderStreamSettings& Settings);
+
+    // Closes the current frame and sends the aggregated window when the send interval has elapsed. Game thread.
+    void EndFrame();
+
+private:
+    enum EAggregate : uint8
+    {
+        A_Min,
+        A_Avg,
+        A_Max,
+        A_P99,
+        A_Count
+    };
+
+    struct FMetric
+    {
+        FString Name;
+        std::string ExportNames[A_Count + 1]; // one per aggregate, then the plain name used when the window is a single frame
+        bool bExported = true;
+
+        std::atomic<uint32> Value{ 0 }; // float bits
+        std::atomic<bool> bRecorded{ false };
+
+        TArray<float> Window;
+        int32 WindowHead = 0;
+        int32 WindowCount = 0;
+        bool bRecordedSinceSend = false;
+    };
+
+    FRenderStreamTelemetry();
+
+    bool IsExported(const FString& Name) const;
+    void ResizeWindow(FMetric& Metric) const;
+
+    FCriticalSection m_registrationLock;
+    TUniquePtr<FMetric[]> m_metrics;
+    std::atomic<int32> m_numMetrics{ 0 };
+
+    int32 m_windowFrames = 1;
+    int32 m_sendInterval = 1;
+    bool m_aggregates[A_Count] = { false, true, true, true };
+    TArray<FString> m_exportFilter;
+
+    int32 m_framesSinceSend = 0;
+    TArray<float> m_scratch;
+    TArray<RenderStreamLink::ProfilingEntry> m_entries;
+};
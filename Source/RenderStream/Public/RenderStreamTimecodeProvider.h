@@ -22,7 +22,4 @@ public:
 
 	/** This Provider stopped being the Engine's Provider. */
     void Shutdown(class UEngine* InEngine) override {};
-
-private:
-	mutable FQualifiedFrameTime LastTime;
 };
\ No newline at end of file
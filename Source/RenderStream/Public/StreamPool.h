@@ -4,18 +4,82 @@
 
 #include "RenderStreamLink.h"
 
+#include <atomic>
+
 class FFrameStream;
+struct FFrameStreamState;
+enum class EStreamChange : uint8;
 
 using FFrameStreamPtr = TSharedPtr<FFrameStream, ESPMode::ThreadSafe>;
+using FFrameStreamStatePtr = TSharedPtr<const FFrameStreamState, ESPMode::ThreadSafe>;
+
+// Fragments of one camera view sent through the same channel. Only the leader's viewport renders, with the union of the
+// fragments' clipping, and every fragment is sent as a crop of that render target. Duplicate streams, which d3 asks for
+// when several machines want the same output of a mapping, are fragments with the same crop and share one blit. Streams
+// of different mappings are never grouped, even when identical: the camera a stream renders from is only known per frame
+// from rs_getFrameCamera, so the mapping and viewpoint are what says two streams see the same view.
+struct FStreamFragmentGroup
+{
+    struct FFragment
+    {
+        FFrameStreamPtr Stream;
+        RenderStreamLink::ProjectionClipping Crop; // the fragment's part of the union, normalised
+        int32 Source; // index of the first fragment with identical output, its own when it has none
+    };
 
+    FFrameStreamPtr Leader;
+    RenderStreamLink::ProjectionClipping Clipping; // union of the fragments' clipping
+    FIntPoint Resolution; // of the union, at the highest pixel density of the fragments
+    TArray<FFragment> Fragments; // leader included
+};
+
+// Immutable index of the pooled streams. FString keys hash and compare case-insensitively.
+struct FStreamPoolSnapshot
+{
+    TArray<FFrameStreamStatePtr> States; // the streams' states when published, kept alive for as long as the snapshot
+    TMap<FString, FFrameStreamPtr> ByName;
+    TMap<RenderStreamLink::StreamHandle, FFrameStreamPtr> ByHandle;
+    TMap<FString, TSharedPtr<const FStreamFragmentGroup>> GroupsByName; // by the name of every fragment
+};
+
+// Streams are added, allocated, updated and removed on the game thread. Every change publishes a new snapshot with a single
+// atomic store, so lookups from any thread are a load and a hash lookup with no lock. Replaced snapshots are freed after the
+// frames in flight, like retired streams, so a lookup in progress on the rendering thread never sees one disappear.
 class FStreamPool
 {
 public:
+    FStreamPool();
+    ~FStreamPool();
+
     // add a stream to the pool for anything to get
     bool AddNewStreamToPool(const FString& StreamName, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt);
 
-    // get the stream by name
-    FFrameStreamPtr GetStream(const FString& desiredStreamName);
+    // get the stream by name, any thread
+    FFrameStreamPtr GetStream(const FString& desiredStreamName) const;
+
+    // get the stream by RenderStream handle, any thread
+    FFrameStreamPtr GetStreamByHandle(RenderStreamLink::StreamHandle Handle) const;
+
+    // apply d3's new description to a pooled stream, see FFrameStream::Update. Nothing is published when it fails.
+    EStreamChange UpdateStream(const FFrameStreamPtr& Stream, const FIntPoint& Resolution, const FString& Channel, const RenderStreamLink::ProjectionClipping& Clipping, RenderStreamLink::StreamHandle Handle, RenderStreamLink::RSPixelFormat Fmt);
+
+    // get the group the stream is a fragment of, or nullptr when it renders by itself. Any thread, the group stays valid
+    // for the frames in flight.
+    const FStreamFragmentGroup* GetFragmentGroup(const FString& StreamName) const;
+
+    // Game thread, once per frame while drawing. The frame's sends on the rendering thread use the groups as they are now,
+    // even when the game thread regroups before they run.
+    void CaptureFrameGroups();
+
+    // Rendering thread, the group the stream was drawn in for the frame being rendered, see CaptureFrameGroups
+    const FStreamFragmentGroup* GetFrameFragmentGroup_RenderThread(const FString& StreamName) const;
+
+    // the resolution of the viewport rendering the stream, the union's when it leads a fragment group
+    FIntPoint GetRenderResolution(const FFrameStreamPtr& Stream) const;
+
+    // group the fragments of each camera view and/or its duplicate streams, see URenderStreamSettings::RenderFragmentsOnce
+    // and DeduplicateStreams. Groups are rebuilt whenever the pool publishes, call this once d3's descriptions are applied
+    void SetGrouping(bool bFragments, bool bDuplicates);
 
     // passing a UID for the id, allocate a stream for that objects use
     // the stream is allocated for only that object to use
@@ -24,6 +88,12 @@ public:
     // passing a UID for the id, return an allocated stream to the pool
     void ReturnStreamFor(uint32 uid);
 
+    // remove a stream d3 no longer provides; it stops sending immediately and is released after the frames in flight
+    void RetireStream(const FFrameStreamPtr& Stream);
+
+    // release retired streams and snapshots no frame in flight can still be using
+    void CollectRetired();
+
     // get the allocated streams which are all considered "active"
     const TMap<uint32, FFrameStreamPtr>& GetActiveStreams() const;
 
@@ -33,6 +103,19 @@ public:
     uint32_t StreamCount() const;
 
 private:
+    void Publish();
+    void GroupStreams(FStreamPoolSnapshot& Snapshot) const;
+    static void AddGroup(FStreamPoolSnapshot& Snapshot, const TArray<FFrameStreamPtr>& Streams);
+
     TArray<FFrameStreamPtr> m_pool;
     TMap<uint32, FFrameStreamPtr> m_allocated;
+    TArray<TPair<uint64, FFrameStreamPtr>> m_retired; // frame retired, stream
+    bool m_groupFragments = false;
+    bool m_groupDuplicates = false;
+
+    std::atomic<const FStreamPoolSnapshot*> m_snapshot{ nullptr };
+    const FStreamPoolSnapshot* m_frameSnapshot = nullptr; // rendering thread, the snapshot frame m_frameSnapshotFrame was drawn with
+    uint64 m_frameSnapshotFrame = 0;
+    TUniquePtr<const FStreamPoolSnapshot> m_snapshotOwner;
+    TArray<TPair<uint64, TUniquePtr<const FStreamPoolSnapshot>>> m_retiredSnapshots; // frame replaced, snapshot
 };
\ No newline at end of file